@@ -0,0 +1,188 @@
+#include "BatchReconstruction.hpp"
+
+#include "BoundedQueue.hpp"
+#include "NumThreadsScope.hpp"
+#include "Profiler.hpp"
+#include "ProgressReporter.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace yrt::petsird
+{
+	namespace
+	{
+		struct BatchJob
+		{
+			ReconstructionOptions options;
+			std::string profile_fname;
+		};
+
+		// Job whose ingest is done (or failed)
+		struct IngestedJob
+		{
+			size_t job_i;
+			std::unique_ptr<Profiler> profiler;
+			std::optional<PreparedAcquisition> acquisition;
+			std::exception_ptr error;
+		};
+
+		std::vector<BatchJob>
+		    readManifest(const std::string& manifest_fname,
+		                 const ReconstructionOptions& defaults)
+		{
+			std::ifstream manifestFile{manifest_fname};
+			if (!manifestFile.is_open())
+			{
+				throw std::runtime_error("Could not open " + manifest_fname);
+			}
+			const nlohmann::json manifest = nlohmann::json::parse(manifestFile);
+
+			ReconstructionOptions manifestDefaults = defaults;
+			const nlohmann::json* jobs = &manifest;
+			if (manifest.is_object())
+			{
+				const auto defaultsIt = manifest.find("defaults");
+				if (defaultsIt != manifest.end())
+				{
+					applyReconstructionJob(*defaultsIt, manifestDefaults);
+				}
+				jobs = &manifest.at("jobs");
+			}
+			if (!jobs->is_array())
+			{
+				throw std::invalid_argument(
+				    "The manifest must be an array of jobs or an object "
+				    "with a \"jobs\" array");
+			}
+
+			std::vector<BatchJob> batchJobs;
+			for (const auto& job : *jobs)
+			{
+				BatchJob batchJob;
+				batchJob.options =
+				    parseReconstructionJob(job, manifestDefaults);
+				batchJob.profile_fname = job.value("profile_json", "");
+				batchJobs.push_back(std::move(batchJob));
+			}
+			return batchJobs;
+		}
+	}  // namespace
+
+	size_t runBatchReconstruction(const std::string& manifest_fname,
+	                              const ReconstructionOptions& defaults,
+	                              std::chrono::milliseconds progressInterval,
+	                              size_t maxNumSensitivityImageSets)
+	{
+		const std::vector<BatchJob> jobs =
+		    readManifest(manifest_fname, defaults);
+		const size_t numJobs = jobs.size();
+		std::cout << "Batch of " << numJobs << " jobs" << std::endl;
+
+		// Every scanner of the batch can stay converted. The sensitivity
+		//  images are only reused between jobs with identical settings, so
+		//  only a few sets stay in memory
+		ReconstructionCaches caches{
+		    numJobs, std::max<size_t>(maxNumSensitivityImageSets, 1)};
+
+		// The ingest of the next job overlaps the reconstruction of the
+		//  current one, so each gets half of the threads
+		const int numThreadsPerStage =
+		    numJobs > 1 ? std::max(globals::getNumThreads() / 2, 1)
+		                : globals::getNumThreads();
+		const NumThreadsScope numThreadsScope{numThreadsPerStage};
+
+		BoundedQueue<IngestedJob> ingestedJobs{1};
+		// An ingest starts only once it takes a slot, which the consumer
+		//  gives back after freeing a reconstructed acquisition. Two slots
+		//  bound the memory to two acquisitions: The one being
+		//  reconstructed and the next one
+		constexpr size_t NumAcquisitionSlots = 2;
+		BoundedQueue<bool> acquisitionSlots{NumAcquisitionSlots};
+		for (size_t slot_i = 0; slot_i < NumAcquisitionSlots; slot_i++)
+		{
+			acquisitionSlots.push(true);
+		}
+
+		std::thread ingestThread{
+		    [&]
+		    {
+			    ProgressReporter ingestProgress{std::cout, progressInterval,
+			                                    numThreadsPerStage};
+			    for (size_t job_i = 0; job_i < numJobs; job_i++)
+			    {
+				    if (!acquisitionSlots.pop())
+				    {
+					    break;
+				    }
+				    IngestedJob ingested;
+				    ingested.job_i = job_i;
+				    ingested.profiler = std::make_unique<Profiler>();
+				    ingested.profiler->setContext(
+				        "input", jobs[job_i].options.input_fname);
+				    ingested.profiler->setContext(
+				        "num_threads", std::to_string(numThreadsPerStage));
+				    try
+				    {
+					    ingested.acquisition.emplace(prepareAcquisition(
+					        jobs[job_i].options, &caches, *ingested.profiler,
+					        ingestProgress));
+				    }
+				    catch (...)
+				    {
+					    ingested.error = std::current_exception();
+				    }
+				    if (!ingestedJobs.push(std::move(ingested)))
+				    {
+					    break;
+				    }
+			    }
+			    ingestedJobs.close();
+		    }};
+
+		ProgressReporter reconProgress{std::cout, progressInterval,
+		                               numThreadsPerStage};
+		size_t numFailedJobs = 0;
+		while (auto ingested = ingestedJobs.pop())
+		{
+			const BatchJob& job = jobs[ingested->job_i];
+			std::cout << "Job " << ingested->job_i + 1 << "/" << numJobs
+			          << ": " << job.options.input_fname << std::endl;
+			try
+			{
+				if (ingested->error != nullptr)
+				{
+					std::rethrow_exception(ingested->error);
+				}
+				reconstructAcquisition(*ingested->acquisition, job.options,
+				                       &caches, *ingested->profiler,
+				                       reconProgress);
+				if (!job.profile_fname.empty())
+				{
+					ingested->profiler->writeJSON(job.profile_fname);
+				}
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "Job " << ingested->job_i + 1 << " ("
+				          << job.options.input_fname
+				          << ") failed: " << e.what() << std::endl;
+				numFailedJobs++;
+			}
+			ingested.reset();
+			acquisitionSlots.push(true);
+		}
+		ingestThread.join();
+
+		return numFailedJobs;
+	}
+}  // namespace yrt::petsird
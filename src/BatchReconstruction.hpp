@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Reconstruction.hpp"
+
+#include <chrono>
+#include <string>
+
+namespace yrt::petsird
+{
+	/*
+	 * Reconstructs all the jobs of a JSON manifest in one process:
+	 *  {
+	 *      "defaults": {"params": "params.json", "num_iterations": 5},
+	 *      "jobs": [
+	 *          {"input": "a.petsird", "out": "a.nii"},
+	 *          {"input": "b.petsird", "out": "b.nii", "profile_json": "b.json"}
+	 *      ]
+	 *  }
+	 * The keys are those of parseReconstructionJob, plus "profile_json". The
+	 *  "defaults" section (optional) overrides the given defaults for every
+	 *  job. A manifest can also be a plain array of jobs.
+	 *
+	 * Jobs on the same scanner share the converted scanner, the
+	 *  normalisation and the sensitivity images. At most
+	 *  maxNumSensitivityImageSets sets of sensitivity images stay in memory
+	 *  (The on-disk cache, if enabled, keeps the others). The ingest of the
+	 *  next job runs in a separate thread while the current job is
+	 *  reconstructed.
+	 *
+	 * Returns the number of jobs that failed (The other jobs still run)
+	 * */
+	size_t runBatchReconstruction(const std::string& manifest_fname,
+	                              const ReconstructionOptions& defaults,
+	                              std::chrono::milliseconds progressInterval,
+	                              size_t maxNumSensitivityImageSets = 2);
+}  // namespace yrt::petsird
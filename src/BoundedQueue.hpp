@@ -0,0 +1,100 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace yrt::petsird
+{
+	// Thread-safe FIFO queue holding at most `capacity` items. Once closed,
+	//  pushes are refused and pops return the remaining items, then nullopt
+	template <typename T>
+	class BoundedQueue
+	{
+	public:
+		explicit BoundedQueue(size_t capacity) : m_capacity(capacity) {}
+
+		// Returns false (and leaves the item untouched) if the queue is full
+		//  or closed
+		bool tryPush(T& item)
+		{
+			{
+				std::lock_guard lock{m_mutex};
+				if (m_isClosed || m_items.size() >= m_capacity)
+				{
+					return false;
+				}
+				m_items.push_back(std::move(item));
+			}
+			m_notEmpty.notify_one();
+			return true;
+		}
+
+		// Waits while the queue is full. Returns false if the queue is closed
+		bool push(T item)
+		{
+			{
+				std::unique_lock lock{m_mutex};
+				m_notFull.wait(lock,
+				               [this]
+				               {
+					               return m_isClosed ||
+					                      m_items.size() < m_capacity;
+				               });
+				if (m_isClosed)
+				{
+					return false;
+				}
+				m_items.push_back(std::move(item));
+			}
+			m_notEmpty.notify_one();
+			return true;
+		}
+
+		// Waits for an item. Returns nullopt once the queue is closed and
+		//  empty
+		std::optional<T> pop()
+		{
+			std::optional<T> item;
+			{
+				std::unique_lock lock{m_mutex};
+				m_notEmpty.wait(lock, [this]
+				                { return m_isClosed || !m_items.empty(); });
+				if (m_items.empty())
+				{
+					return std::nullopt;
+				}
+				item.emplace(std::move(m_items.front()));
+				m_items.pop_front();
+			}
+			m_notFull.notify_one();
+			return item;
+		}
+
+		void close()
+		{
+			{
+				std::lock_guard lock{m_mutex};
+				m_isClosed = true;
+			}
+			m_notEmpty.notify_all();
+			m_notFull.notify_all();
+		}
+
+		size_t size() const
+		{
+			std::lock_guard lock{m_mutex};
+			return m_items.size();
+		}
+
+	private:
+		const size_t m_capacity;
+		std::deque<T> m_items;
+		bool m_isClosed = false;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_notEmpty;
+		std::condition_variable m_notFull;
+	};
+}  // namespace yrt::petsird
@@ -0,0 +1,176 @@
+#include "Gating.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace yrt::petsird
+{
+	namespace
+	{
+		// Signal samples, in time order
+		struct SignalSamples
+		{
+			std::vector<double> times;  // in ms
+			std::vector<float> values;
+		};
+
+		SignalSamples getSignalSamples(
+		    const std::vector<::petsird::ExternalSignalTimeBlock>& signalBlocks,
+		    uint32_t signalId)
+		{
+			std::vector<const ::petsird::ExternalSignalTimeBlock*> blocks;
+			for (const auto& block : signalBlocks)
+			{
+				if (block.signal_id == signalId)
+				{
+					blocks.push_back(&block);
+				}
+			}
+			std::stable_sort(blocks.begin(), blocks.end(),
+			                 [](const auto* a, const auto* b)
+			                 {
+				                 return a->time_interval.start <
+				                        b->time_interval.start;
+			                 });
+
+			// The values of a block are spread evenly over its time interval
+			SignalSamples samples;
+			for (const auto* block : blocks)
+			{
+				const double start = block->time_interval.start;
+				const double duration =
+				    static_cast<double>(block->time_interval.stop) - start;
+				const size_t numValues = block->signal_values.size();
+				for (size_t value_i = 0; value_i < numValues; value_i++)
+				{
+					samples.times.push_back(start + duration * value_i /
+					                                     numValues);
+					samples.values.push_back(block->signal_values[value_i]);
+				}
+			}
+			return samples;
+		}
+
+		std::vector<double> getTriggerTimes(
+		    const std::vector<::petsird::ExternalSignalTimeBlock>& signalBlocks,
+		    uint32_t signalId)
+		{
+			std::vector<double> triggerTimes;
+			for (const auto& block : signalBlocks)
+			{
+				if (block.signal_id == signalId)
+				{
+					triggerTimes.push_back(block.time_interval.start);
+				}
+			}
+			std::sort(triggerTimes.begin(), triggerTimes.end());
+			triggerTimes.erase(
+			    std::unique(triggerTimes.begin(), triggerTimes.end()),
+			    triggerTimes.end());
+			return triggerTimes;
+		}
+	}  // namespace
+
+	GatingMode parseGatingMode(const std::string& gatingMode_str)
+	{
+		if (gatingMode_str == "phase")
+		{
+			return GatingMode::Phase;
+		}
+		if (gatingMode_str == "amplitude")
+		{
+			return GatingMode::Amplitude;
+		}
+		throw std::invalid_argument("Unknown gating mode: " + gatingMode_str);
+	}
+
+	std::vector<uint32_t> computeEventGates(
+	    const std::vector<::petsird::ExternalSignalTimeBlock>& signalBlocks,
+	    const GatingOptions& options,
+	    const EventVector<timestamp_t>& timestamps)
+	{
+		if (options.numGates <= 0)
+		{
+			throw std::invalid_argument("The number of gates must be positive");
+		}
+		const uint32_t numGates = static_cast<uint32_t>(options.numGates);
+		const size_t numEvents = timestamps.size();
+		std::vector<uint32_t> gates(numEvents, NO_GATE);
+
+		if (options.mode == GatingMode::Phase)
+		{
+			const std::vector<double> triggerTimes =
+			    getTriggerTimes(signalBlocks, options.signalId);
+			if (triggerTimes.size() < 2)
+			{
+				throw std::runtime_error(
+				    "Phase gating requires at least two triggers of signal " +
+				    std::to_string(options.signalId));
+			}
+
+#pragma omp parallel for num_threads(globals::getNumThreads())
+			for (size_t evId = 0; evId < numEvents; evId++)
+			{
+				const double time = timestamps[evId];
+				const auto next = std::upper_bound(triggerTimes.begin(),
+				                                   triggerTimes.end(), time);
+				if (next == triggerTimes.begin() || next == triggerTimes.end())
+				{
+					continue;
+				}
+				const double previousTrigger = *(next - 1);
+				const double phase =
+				    (time - previousTrigger) / (*next - previousTrigger);
+				gates[evId] = std::min(
+				    static_cast<uint32_t>(phase * numGates), numGates - 1);
+			}
+			return gates;
+		}
+
+		const SignalSamples samples =
+		    getSignalSamples(signalBlocks, options.signalId);
+		if (samples.times.empty())
+		{
+			throw std::runtime_error(
+			    "Amplitude gating requires samples of signal " +
+			    std::to_string(options.signalId));
+		}
+
+		// Upper value of each gate but the last (quantiles of the samples)
+		std::vector<float> sortedValues = samples.values;
+		std::sort(sortedValues.begin(), sortedValues.end());
+		std::vector<float> gateThresholds(numGates - 1);
+		for (uint32_t gate = 0; gate + 1 < numGates; gate++)
+		{
+			gateThresholds[gate] =
+			    sortedValues[(gate + 1) * sortedValues.size() / numGates];
+		}
+
+		// The signal is held from one sample to the next, up to the last
+		//  sample
+		const double firstTime = samples.times.front();
+		const double lastTime = samples.times.back();
+
+#pragma omp parallel for num_threads(globals::getNumThreads())
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			const double time = timestamps[evId];
+			if (time < firstTime || time > lastTime)
+			{
+				continue;
+			}
+			const size_t sample_i =
+			    std::upper_bound(samples.times.begin(), samples.times.end(),
+			                     time) -
+			    samples.times.begin() - 1;
+			const float value = samples.values[sample_i];
+			gates[evId] = static_cast<uint32_t>(
+			    std::upper_bound(gateThresholds.begin(), gateThresholds.end(),
+			                     value) -
+			    gateThresholds.begin());
+		}
+		return gates;
+	}
+}  // namespace yrt::petsird
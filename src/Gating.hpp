@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ScratchAllocator.hpp"
+
+#include "petsird/types.h"
+#include "yrt-pet/utils/Types.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird
+{
+	enum class GatingMode
+	{
+		// Gate by the position of the event between two triggers (The start
+		//  of each time block of the signal is a trigger)
+		Phase,
+		// Gate by the value of the signal trace at the time of the event.
+		//  The gates split the range of the trace values so that they hold
+		//  the same number of samples
+		Amplitude
+	};
+
+	// "phase" or "amplitude"
+	GatingMode parseGatingMode(const std::string& gatingMode_str);
+
+	struct GatingOptions
+	{
+		int numGates = 0;  // 0 to disable the gating
+		uint32_t signalId = 0;  // signal_id of the external signal blocks
+		GatingMode mode = GatingMode::Phase;
+	};
+
+	// Events that no gate covers (before the first trigger or sample of the
+	//  signal, or after the last one)
+	constexpr uint32_t NO_GATE = std::numeric_limits<uint32_t>::max();
+
+	// Gate of each event, given its timestamp (in ms) and the external signal
+	//  time blocks of the acquisition (in any order, of any signal_id)
+	std::vector<uint32_t> computeEventGates(
+	    const std::vector<::petsird::ExternalSignalTimeBlock>& signalBlocks,
+	    const GatingOptions& options,
+	    const EventVector<timestamp_t>& timestamps);
+}  // namespace yrt::petsird
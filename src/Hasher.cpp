@@ -0,0 +1,62 @@
+#include "Hasher.hpp"
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace yrt::petsird
+{
+	void Hasher::update(const void* data, size_t numBytes)
+	{
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		uint64_t state = m_state;
+		for (size_t i = 0; i < numBytes; i++)
+		{
+			state ^= bytes[i];
+			state *= FNV_PRIME;
+		}
+		m_state = state;
+	}
+
+	void Hasher::updateString(const std::string& str)
+	{
+		updateArray(str.data(), str.size());
+	}
+
+	void Hasher::updateFile(const std::string& fname)
+	{
+		std::ifstream file{fname, std::ios::binary};
+		if (!file.is_open())
+		{
+			// A key that does not follow the content could match a stale
+			//  entry
+			throw std::runtime_error("Could not open " + fname +
+			                         " to hash its content");
+		}
+
+		std::array<char, 1 << 16> buffer{};
+		size_t totalBytes = 0;
+		while (file)
+		{
+			file.read(buffer.data(), buffer.size());
+			const auto numRead = static_cast<size_t>(file.gcount());
+			update(buffer.data(), numRead);
+			totalBytes += numRead;
+		}
+		updateValue(totalBytes);
+	}
+
+	uint64_t Hasher::digest() const
+	{
+		return m_state;
+	}
+
+	std::string Hasher::hexDigest() const
+	{
+		char buf[17];
+		std::snprintf(buf, sizeof(buf), "%016llx",
+		              static_cast<unsigned long long>(m_state));
+		return std::string{buf};
+	}
+}  // namespace yrt::petsird
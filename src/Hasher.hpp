@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace yrt::petsird
+{
+	// Incremental 64-bit FNV-1a hash. Used to build content-addressed keys
+	//  (Not meant to be cryptographically secure)
+	class Hasher
+	{
+	public:
+		void update(const void* data, size_t numBytes);
+
+		template <typename T>
+		void updateValue(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>,
+			              "Only trivially copyable values can be hashed");
+			update(&value, sizeof(T));
+		}
+
+		template <typename T>
+		void updateArray(const T* values, size_t numValues)
+		{
+			static_assert(std::is_trivially_copyable_v<T>,
+			              "Only trivially copyable values can be hashed");
+			updateValue(numValues);
+			update(values, numValues * sizeof(T));
+		}
+
+		void updateString(const std::string& str);
+
+		// Hashes the content of the file. Throws if the file cannot be
+		//  opened
+		void updateFile(const std::string& fname);
+
+		uint64_t digest() const;
+		std::string hexDigest() const;
+
+	private:
+		static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+		static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+		uint64_t m_state = FNV_OFFSET_BASIS;
+	};
+}  // namespace yrt::petsird
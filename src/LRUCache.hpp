@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace yrt::petsird
+{
+	// Thread-safe cache holding at most `capacity` values, evicting the least
+	//  recently used one. Values are shared: An evicted value stays alive as
+	//  long as it is used elsewhere
+	template <typename Key, typename Value>
+	class LRUCache
+	{
+	public:
+		explicit LRUCache(size_t capacity) : m_capacity(capacity) {}
+
+		// Returns nullptr if the key is not in the cache
+		std::shared_ptr<Value> get(const Key& key)
+		{
+			std::lock_guard lock{m_mutex};
+			const auto it = m_index.find(key);
+			if (it == m_index.end())
+			{
+				return nullptr;
+			}
+			// Move the entry to the front (most recently used)
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			return it->second->second;
+		}
+
+		// Inserts or replaces the value of the key
+		void put(const Key& key, std::shared_ptr<Value> value)
+		{
+			if (m_capacity == 0)
+			{
+				return;
+			}
+			std::lock_guard lock{m_mutex};
+			const auto it = m_index.find(key);
+			if (it != m_index.end())
+			{
+				it->second->second = std::move(value);
+				m_entries.splice(m_entries.begin(), m_entries, it->second);
+				return;
+			}
+			if (m_entries.size() >= m_capacity)
+			{
+				m_index.erase(m_entries.back().first);
+				m_entries.pop_back();
+			}
+			m_entries.emplace_front(key, std::move(value));
+			m_index[key] = m_entries.begin();
+		}
+
+		size_t size() const
+		{
+			std::lock_guard lock{m_mutex};
+			return m_entries.size();
+		}
+
+	private:
+		using Entry = std::pair<Key, std::shared_ptr<Value>>;
+
+		const size_t m_capacity;
+		// Most recently used first
+		std::list<Entry> m_entries;
+		std::unordered_map<Key, typename std::list<Entry>::iterator> m_index;
+		mutable std::mutex m_mutex;
+	};
+}  // namespace yrt::petsird
@@ -0,0 +1,117 @@
+#include "ListModeBinning.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace yrt::petsird
+{
+	bool shouldUseHistogramMode(DataMode dataMode, size_t numEvents,
+	                            size_t numHistogramBins, bool useTOF,
+	                            float threshold)
+	{
+		if (dataMode == DataMode::Histogram)
+		{
+			if (useTOF)
+			{
+				throw std::invalid_argument(
+				    "Histogram-mode reconstruction does not support TOF");
+			}
+			return true;
+		}
+		if (dataMode == DataMode::ListMode || useTOF)
+		{
+			return false;
+		}
+		return static_cast<double>(numEvents) >
+		       static_cast<double>(threshold) *
+		           static_cast<double>(numHistogramBins);
+	}
+
+	void binListModeToHistogram(const ListMode& lm, Histogram3D& histo,
+	                            size_t maxPartialHistogramsBytes)
+	{
+		const size_t numEvents = lm.count();
+		const size_t numBins = histo.count();
+		const int numThreads = std::max(globals::getNumThreads(), 1);
+		const bool isWeighted = !lm.isUniform();
+
+		const auto getBin = [&](size_t evId)
+		{
+			const det_pair_t detPair = lm.getDetectorPair(evId);
+			return histo.getBinIdFromDetPair(detPair.d1, detPair.d2);
+		};
+		const auto getWeight = [&](size_t evId)
+		{ return isWeighted ? lm.getProjectionValue(evId) : 1.0f; };
+
+		// Accumulated in place, in the histogram's own storage
+		histo.clearProjections(0.0f);
+		float* totals = histo.getData().getRawPointer();
+
+		// The first partial histogram is the output itself
+		const double partialHistogramsBytes =
+		    static_cast<double>(numThreads - 1) *
+		    static_cast<double>(numBins) * sizeof(float);
+		const bool usePartialHistograms =
+		    numThreads > 1 &&
+		    partialHistogramsBytes <=
+		        static_cast<double>(maxPartialHistogramsBytes);
+
+		if (usePartialHistograms)
+		{
+			std::vector<std::vector<float>> partials(numThreads - 1);
+
+#pragma omp parallel num_threads(numThreads)
+			{
+#if defined(_OPENMP)
+				const int thread_i = omp_get_thread_num();
+#else
+				const int thread_i = 0;
+#endif
+				float* partial = totals;
+				if (thread_i > 0)
+				{
+					partials[thread_i - 1].assign(numBins, 0.0f);
+					partial = partials[thread_i - 1].data();
+				}
+
+#pragma omp for schedule(static)
+				for (size_t evId = 0; evId < numEvents; evId++)
+				{
+					partial[getBin(evId)] += getWeight(evId);
+				}
+
+				// Reduce the partial histograms (The implicit barrier of the
+				//  loop above guarantees they are all complete)
+#pragma omp for schedule(static)
+				for (size_t bin = 0; bin < numBins; bin++)
+				{
+					for (const auto& otherPartial : partials)
+					{
+						if (!otherPartial.empty())
+						{
+							totals[bin] += otherPartial[bin];
+						}
+					}
+				}
+			}
+		}
+		else
+		{
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+			for (size_t evId = 0; evId < numEvents; evId++)
+			{
+				const bin_t bin = getBin(evId);
+				const float weight = getWeight(evId);
+#pragma omp atomic
+				totals[bin] += weight;
+			}
+		}
+	}
+}  // namespace yrt::petsird
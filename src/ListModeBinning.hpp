@@ -0,0 +1,33 @@
+#pragma once
+
+#include "yrt-pet/datastruct/projection/Histogram3D.hpp"
+#include "yrt-pet/datastruct/projection/ListMode.hpp"
+
+namespace yrt::petsird
+{
+	enum class DataMode
+	{
+		Auto,
+		ListMode,
+		Histogram
+	};
+
+	// Events per histogram bin above which the automatic mode selects
+	//  histogram-mode reconstruction
+	constexpr float DEFAULT_HISTOGRAM_MODE_THRESHOLD = 2.0f;
+
+	// Returns whether histogram-mode OSEM is cheaper than list-mode OSEM.
+	//  Histograms do not store TOF, so list-mode is always used with TOF
+	bool shouldUseHistogramMode(
+	    DataMode dataMode, size_t numEvents, size_t numHistogramBins,
+	    bool useTOF, float threshold = DEFAULT_HISTOGRAM_MODE_THRESHOLD);
+
+	// Accumulates the events of the list-mode (weighted by their projection
+	//  value) into the histogram, which must be allocated. Its previous
+	//  values are cleared. The first thread accumulates straight into the
+	//  histogram and each other thread fills a partial histogram if they fit
+	//  in the given memory budget, otherwise the threads accumulate into the
+	//  histogram with atomic additions
+	void binListModeToHistogram(const ListMode& lm, Histogram3D& histo,
+	                            size_t maxPartialHistogramsBytes = 1ull << 32);
+}  // namespace yrt::petsird
@@ -0,0 +1,104 @@
+#include "ListModeLUTWriter.hpp"
+
+#include "Tracer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace yrt::petsird
+{
+	ListModeLUTWriter::ListModeLUTWriter(const std::string& fname,
+	                                     bool withTOF, size_t bufferNumEvents)
+	    : m_fname(fname),
+	      m_file(fname, std::ios::out | std::ios::binary | std::ios::trunc),
+	      m_withTOF(withTOF),
+	      m_numFields(withTOF ? 4 : 3),
+	      m_bufferNumEvents(std::max<size_t>(bufferNumEvents, 1)),
+	      m_numEventsInBuffer(0),
+	      m_numEventsWritten(0)
+	{
+		if (!m_file.is_open())
+		{
+			throw std::runtime_error("Could not open " + fname +
+			                         " for writing");
+		}
+		m_buffer.resize(m_bufferNumEvents * m_numFields);
+	}
+
+	ListModeLUTWriter::~ListModeLUTWriter()
+	{
+		// Errors can only be reported by an explicit close()
+		if (m_file.is_open())
+		{
+			try
+			{
+				close();
+			}
+			catch (...)
+			{
+			}
+		}
+	}
+
+	void ListModeLUTWriter::writeEvents(const PETSIRDListMode& lm,
+	                                    size_t begin, size_t end)
+	{
+		const TraceSpan writeSpan{"ListModeLUTWriter: write events"};
+
+		const EventVector<timestamp_t>& timestamps = lm.getTimestampArray();
+		const EventVector<det_id_t>& d0s = lm.getDetector1Array();
+		const EventVector<det_id_t>& d1s = lm.getDetector2Array();
+		const EventVector<float>& tofs = lm.getTOFArray();
+
+		for (size_t evId = begin; evId < end; evId++)
+		{
+			uint32_t* record = &m_buffer[m_numEventsInBuffer * m_numFields];
+			record[0] = static_cast<uint32_t>(timestamps[evId]);
+			record[1] = static_cast<uint32_t>(d0s[evId]);
+			record[2] = static_cast<uint32_t>(d1s[evId]);
+			if (m_withTOF)
+			{
+				std::memcpy(&record[3], &tofs[evId], sizeof(float));
+			}
+
+			if (++m_numEventsInBuffer == m_bufferNumEvents)
+			{
+				flush();
+			}
+		}
+	}
+
+	void ListModeLUTWriter::writeEvents(const PETSIRDListMode& lm)
+	{
+		writeEvents(lm, 0, lm.count());
+	}
+
+	void ListModeLUTWriter::flush()
+	{
+		m_file.write(reinterpret_cast<const char*>(m_buffer.data()),
+		             static_cast<std::streamsize>(
+		                 m_numEventsInBuffer * m_numFields * sizeof(uint32_t)));
+		if (!m_file)
+		{
+			throw std::runtime_error("Error while writing " + m_fname);
+		}
+		m_numEventsWritten += m_numEventsInBuffer;
+		m_numEventsInBuffer = 0;
+	}
+
+	void ListModeLUTWriter::close()
+	{
+		flush();
+		m_file.close();
+		if (!m_file)
+		{
+			throw std::runtime_error("Error while closing " + m_fname);
+		}
+	}
+
+	size_t ListModeLUTWriter::getNumEventsWritten() const
+	{
+		return m_numEventsWritten + m_numEventsInBuffer;
+	}
+}  // namespace yrt::petsird
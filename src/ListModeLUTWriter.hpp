@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PETSIRDListMode.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird
+{
+	// Writes events in the list-mode file layout of YRT-PET's ListModeLUT,
+	//  so that the YRT-PET executables can read them without PETSIRD. The
+	//  file has no header; each event is, in native byte order:
+	//  - timestamp (uint32, in ms)
+	//  - first detector (uint32, index in the scanner LUT)
+	//  - second detector (uint32, index in the scanner LUT)
+	//  - TOF value (float32, in ps), only if the writer was created with TOF
+	// The events are interleaved in a fixed-size buffer that is flushed to
+	//  the file whenever it is full
+	class ListModeLUTWriter
+	{
+	public:
+		ListModeLUTWriter(const std::string& fname, bool withTOF,
+		                  size_t bufferNumEvents = 1 << 20);
+		~ListModeLUTWriter();
+
+		ListModeLUTWriter(const ListModeLUTWriter&) = delete;
+		ListModeLUTWriter& operator=(const ListModeLUTWriter&) = delete;
+
+		// Appends the events [begin, end) of the list-mode. Coalesced
+		//  events are written once (The format has no multiplicity)
+		void writeEvents(const PETSIRDListMode& lm, size_t begin, size_t end);
+		void writeEvents(const PETSIRDListMode& lm);
+
+		// Flushes the buffer and closes the file. Throws if the file could
+		//  not be written
+		void close();
+
+		size_t getNumEventsWritten() const;
+
+	private:
+		void flush();
+
+		std::string m_fname;
+		std::ofstream m_file;
+		bool m_withTOF;
+		size_t m_numFields;
+		size_t m_bufferNumEvents;
+		std::vector<uint32_t> m_buffer;
+		size_t m_numEventsInBuffer;
+		size_t m_numEventsWritten;
+	};
+}  // namespace yrt::petsird
@@ -0,0 +1,151 @@
+#include "Motion.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace yrt::petsird
+{
+	namespace
+	{
+		// Pose given by a list of movements at the start of each movement
+		struct Movement
+		{
+			timestamp_t start;
+			transform_t transform;
+		};
+
+		template <typename MovementTimeBlock>
+		std::vector<Movement>
+		    getMovements(const std::vector<MovementTimeBlock>& blocks)
+		{
+			std::vector<Movement> movements;
+			movements.reserve(blocks.size());
+			for (const auto& block : blocks)
+			{
+				movements.push_back(
+				    {block.time_interval.start, toTransform(block.transform)});
+			}
+			std::stable_sort(movements.begin(), movements.end(),
+			                 [](const Movement& a, const Movement& b)
+			                 { return a.start < b.start; });
+			return movements;
+		}
+
+		// Pose at the given time (The last movement started at or before it)
+		transform_t getPose(const std::vector<Movement>& movements,
+		                    timestamp_t time)
+		{
+			const auto next = std::upper_bound(
+			    movements.begin(), movements.end(), time,
+			    [](timestamp_t t, const Movement& movement)
+			    { return t < movement.start; });
+			if (next == movements.begin())
+			{
+				return getIdentityTransform();
+			}
+			return (next - 1)->transform;
+		}
+
+		bool isSameTransform(const transform_t& a, const transform_t& b)
+		{
+			return std::memcmp(&a, &b, sizeof(transform_t)) == 0;
+		}
+	}  // namespace
+
+	std::vector<MotionState> computeMotionStates(
+	    const std::vector<::petsird::BedMovementTimeBlock>& bedMovements,
+	    const std::vector<::petsird::GantryMovementTimeBlock>& gantryMovements)
+	{
+		const std::vector<Movement> bed = getMovements(bedMovements);
+		const std::vector<Movement> gantry = getMovements(gantryMovements);
+
+		// The pose can only change at the start of a movement
+		std::vector<timestamp_t> changeTimes{0};
+		for (const auto* movements : {&bed, &gantry})
+		{
+			for (const Movement& movement : *movements)
+			{
+				changeTimes.push_back(movement.start);
+			}
+		}
+		std::sort(changeTimes.begin(), changeTimes.end());
+		changeTimes.erase(std::unique(changeTimes.begin(), changeTimes.end()),
+		                  changeTimes.end());
+
+		std::vector<MotionState> states;
+		for (const timestamp_t time : changeTimes)
+		{
+			// A point of the scanner is placed in the room by the gantry's
+			//  pose, then brought into the bed's frame
+			const transform_t transform = composeTransforms(
+			    invertTransform(getPose(bed, time)), getPose(gantry, time));
+			if (states.empty() ||
+			    !isSameTransform(states.back().transform, transform))
+			{
+				states.push_back({time, transform});
+			}
+		}
+		return states;
+	}
+
+	frame_t findMotionState(const std::vector<MotionState>& states,
+	                        timestamp_t timestamp)
+	{
+		const auto next = std::upper_bound(
+		    states.begin(), states.end(), timestamp,
+		    [](timestamp_t t, const MotionState& state)
+		    { return t < state.start; });
+		return static_cast<frame_t>(std::max<ptrdiff_t>(
+		    next - states.begin() - 1, 0));
+	}
+
+	transform_t toTransform(const ::petsird::RigidTransformation& rigid)
+	{
+		const auto& m = rigid.matrix;
+		return {m(0, 0), m(0, 1), m(0, 2), m(1, 0), m(1, 1), m(1, 2),
+		        m(2, 0), m(2, 1), m(2, 2), m(0, 3), m(1, 3), m(2, 3)};
+	}
+
+	transform_t getIdentityTransform()
+	{
+		return {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+		        0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f};
+	}
+
+	transform_t composeTransforms(const transform_t& a, const transform_t& b)
+	{
+		transform_t c;
+		c.r00 = a.r00 * b.r00 + a.r01 * b.r10 + a.r02 * b.r20;
+		c.r01 = a.r00 * b.r01 + a.r01 * b.r11 + a.r02 * b.r21;
+		c.r02 = a.r00 * b.r02 + a.r01 * b.r12 + a.r02 * b.r22;
+		c.r10 = a.r10 * b.r00 + a.r11 * b.r10 + a.r12 * b.r20;
+		c.r11 = a.r10 * b.r01 + a.r11 * b.r11 + a.r12 * b.r21;
+		c.r12 = a.r10 * b.r02 + a.r11 * b.r12 + a.r12 * b.r22;
+		c.r20 = a.r20 * b.r00 + a.r21 * b.r10 + a.r22 * b.r20;
+		c.r21 = a.r20 * b.r01 + a.r21 * b.r11 + a.r22 * b.r21;
+		c.r22 = a.r20 * b.r02 + a.r21 * b.r12 + a.r22 * b.r22;
+		c.tx = a.r00 * b.tx + a.r01 * b.ty + a.r02 * b.tz + a.tx;
+		c.ty = a.r10 * b.tx + a.r11 * b.ty + a.r12 * b.tz + a.ty;
+		c.tz = a.r20 * b.tx + a.r21 * b.ty + a.r22 * b.tz + a.tz;
+		return c;
+	}
+
+	transform_t invertTransform(const transform_t& t)
+	{
+		// The inverse of a rotation is its transpose
+		transform_t inv;
+		inv.r00 = t.r00;
+		inv.r01 = t.r10;
+		inv.r02 = t.r20;
+		inv.r10 = t.r01;
+		inv.r11 = t.r11;
+		inv.r12 = t.r21;
+		inv.r20 = t.r02;
+		inv.r21 = t.r12;
+		inv.r22 = t.r22;
+		inv.tx = -(inv.r00 * t.tx + inv.r01 * t.ty + inv.r02 * t.tz);
+		inv.ty = -(inv.r10 * t.tx + inv.r11 * t.ty + inv.r12 * t.tz);
+		inv.tz = -(inv.r20 * t.tx + inv.r21 * t.ty + inv.r22 * t.tz);
+		return inv;
+	}
+}  // namespace yrt::petsird
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "petsird/types.h"
+#include "yrt-pet/utils/Types.hpp"
+
+#include <vector>
+
+namespace yrt::petsird
+{
+	// Rigid pose of the scanner relative to the bed, constant from its start
+	//  time until the start of the next motion state
+	struct MotionState
+	{
+		timestamp_t start;  // in ms
+		// Maps the scanner's coordinates to the bed's (image) coordinates
+		transform_t transform;
+	};
+
+	// Motion states of an acquisition from its bed and gantry movement time
+	//  blocks (in any order). Each movement holds from the start of its
+	//  block until the next movement of the same kind, and the poses before
+	//  the first movement are the identity. The first state starts at 0.
+	//  Consecutive states always have different poses
+	std::vector<MotionState> computeMotionStates(
+	    const std::vector<::petsird::BedMovementTimeBlock>& bedMovements,
+	    const std::vector<::petsird::GantryMovementTimeBlock>& gantryMovements);
+
+	// Index of the motion state at the given time
+	frame_t findMotionState(const std::vector<MotionState>& states,
+	                        timestamp_t timestamp);
+
+	transform_t toTransform(const ::petsird::RigidTransformation& rigid);
+	transform_t getIdentityTransform();
+	// Applies b, then a
+	transform_t composeTransforms(const transform_t& a, const transform_t& b);
+	transform_t invertTransform(const transform_t& transform);
+}  // namespace yrt::petsird
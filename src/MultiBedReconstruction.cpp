@@ -0,0 +1,284 @@
+#include "MultiBedReconstruction.hpp"
+
+#include "NumThreadsScope.hpp"
+#include "Profiler.hpp"
+#include "ProgressReporter.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace yrt::petsird
+{
+	namespace
+	{
+		// Axial position of the bed from the motion state of its events (The
+		//  scanner's center, in the bed's frame). The states that no event
+		//  falls in, such as the identity before the first movement block,
+		//  are ignored
+		float getBedPosition_z(const PETSIRDListMode& listMode,
+		                       const std::string& bed_fname)
+		{
+			const std::vector<MotionState>& states =
+			    listMode.getMotionStates();
+			if (states.empty())
+			{
+				throw std::runtime_error(
+				    bed_fname + " has no bed movement time block to place "
+				                "it (Give the bed positions instead)");
+			}
+			const EventVector<timestamp_t>& timestamps =
+			    listMode.getTimestampArray();
+			if (timestamps.empty())
+			{
+				return states.back().transform.tz;
+			}
+			const auto [firstTimestamp, lastTimestamp] =
+			    std::minmax_element(timestamps.begin(), timestamps.end());
+			const frame_t firstState =
+			    findMotionState(states, *firstTimestamp);
+			if (findMotionState(states, *lastTimestamp) != firstState)
+			{
+				throw std::runtime_error(
+				    "The bed moves during " + bed_fname +
+				    " (Use the motion correction instead)");
+			}
+			return states[firstState].transform.tz;
+		}
+
+	}  // namespace
+
+	void runMultiBedReconstruction(const std::vector<std::string>& bed_fnames,
+	                               const std::vector<float>& bedPositions_z,
+	                               const ReconstructionOptions& options,
+	                               size_t numParallelBeds,
+	                               std::chrono::milliseconds progressInterval,
+	                               const std::string& profile_fname)
+	{
+		const size_t numBeds = bed_fnames.size();
+		if (numBeds == 0)
+		{
+			throw std::invalid_argument("No bed to reconstruct");
+		}
+		if (!bedPositions_z.empty() && bedPositions_z.size() != numBeds)
+		{
+			throw std::invalid_argument(
+			    "There must be one bed position per bed");
+		}
+		if (options.gating.numGates > 0)
+		{
+			throw std::invalid_argument(
+			    "Gating cannot be combined with multiple beds");
+		}
+
+		numParallelBeds = std::clamp<size_t>(numParallelBeds, 1, numBeds);
+		const int numThreadsPerBed = std::max(
+		    globals::getNumThreads() / static_cast<int>(numParallelBeds), 1);
+		std::cout << "Reconstructing " << numBeds << " beds, "
+		          << numParallelBeds << " at a time with " << numThreadsPerBed
+		          << " threads each" << std::endl;
+
+		// Every bed is on the same scanner with the same settings
+		ReconstructionCaches caches{1, 1};
+
+		std::vector<std::unique_ptr<ImageOwned>> bedImages(numBeds);
+		std::vector<float> positions_z = bedPositions_z;
+		positions_z.resize(numBeds);
+		std::vector<std::exception_ptr> errors(numBeds);
+		std::atomic<size_t> nextBed{0};
+
+		const auto reconstructBeds = [&]
+		{
+			ProgressReporter progress{std::cout, progressInterval,
+			                          numThreadsPerBed};
+			for (size_t bed_i = nextBed++; bed_i < numBeds;
+			     bed_i = nextBed++)
+			{
+				try
+				{
+					ReconstructionOptions bedOptions = options;
+					bedOptions.input_fname = bed_fnames[bed_i];
+					bedOptions.outImage_fname = getIndexedFilename(
+					    options.outImage_fname, "bed", bed_i);
+					// The beds are reconstructed in the scanner's frame
+					bedOptions.motionCorrection = false;
+					if (!options.outListMode_fname.empty())
+					{
+						bedOptions.outListMode_fname = getIndexedFilename(
+						    options.outListMode_fname, "bed", bed_i);
+					}
+					if (bed_i > 0)
+					{
+						bedOptions.outScannerLUT_fname.clear();
+						bedOptions.outSensImage_fname.clear();
+					}
+
+					Profiler profiler;
+					profiler.setContext("input", bedOptions.input_fname);
+					profiler.setContext("num_threads",
+					                    std::to_string(numThreadsPerBed));
+					const PreparedAcquisition acquisition = prepareAcquisition(
+					    bedOptions, &caches, profiler, progress);
+					if (bedPositions_z.empty())
+					{
+						if (acquisition.listMode == nullptr)
+						{
+							throw std::runtime_error(
+							    "The bed positions must be given in "
+							    "histogram mode");
+						}
+						positions_z[bed_i] = getBedPosition_z(
+						    *acquisition.listMode, bedOptions.input_fname);
+					}
+					auto images = reconstructAcquisition(
+					    acquisition, bedOptions, &caches, profiler, progress);
+					bedImages[bed_i] = std::move(images.front());
+
+					if (!profile_fname.empty())
+					{
+						profiler.writeJSON(
+						    getIndexedFilename(profile_fname, "bed", bed_i));
+					}
+					std::cout << "Bed " << bed_i + 1 << "/" << numBeds
+					          << " done (at z=" << positions_z[bed_i]
+					          << " mm)" << std::endl;
+				}
+				catch (...)
+				{
+					errors[bed_i] = std::current_exception();
+				}
+			}
+		};
+
+		{
+			const NumThreadsScope numThreadsScope{numThreadsPerBed};
+			std::vector<std::thread> workers;
+			for (size_t worker_i = 1; worker_i < numParallelBeds; worker_i++)
+			{
+				workers.emplace_back(reconstructBeds);
+			}
+			reconstructBeds();
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		for (size_t bed_i = 0; bed_i < numBeds; bed_i++)
+		{
+			if (errors[bed_i] != nullptr)
+			{
+				std::cerr << "Bed " << bed_i + 1 << " (" << bed_fnames[bed_i]
+				          << ") failed" << std::endl;
+				std::rethrow_exception(errors[bed_i]);
+			}
+		}
+
+		std::vector<const Image*> images;
+		for (const auto& bedImage : bedImages)
+		{
+			images.push_back(bedImage.get());
+		}
+		const auto stitchedImage = stitchBedImages(images, positions_z);
+		stitchedImage->writeToFile(options.outImage_fname);
+		std::cout << "Stitched image written to " << options.outImage_fname
+		          << std::endl;
+	}
+
+	std::unique_ptr<ImageOwned>
+	    stitchBedImages(const std::vector<const Image*>& bedImages,
+	                    const std::vector<float>& bedPositions_z)
+	{
+		if (bedImages.empty() || bedImages.size() != bedPositions_z.size())
+		{
+			throw std::invalid_argument(
+			    "There must be one bed position per bed image");
+		}
+		const ImageParams& bedParams = bedImages[0]->getParams();
+		const int nx = bedParams.nx;
+		const int ny = bedParams.ny;
+		const int bedNz = bedParams.nz;
+		const float vz = bedParams.vz;
+		const float halfLength_z = 0.5f * bedParams.length_z;
+
+		const auto [minPosition, maxPosition] =
+		    std::minmax_element(bedPositions_z.begin(), bedPositions_z.end());
+		const float start_z = bedParams.off_z + *minPosition - halfLength_z;
+		const float end_z = bedParams.off_z + *maxPosition + halfLength_z;
+		const int nz =
+		    static_cast<int>(std::ceil((end_z - start_z) / vz - 1e-3f));
+		const float length_z = static_cast<float>(nz) * vz;
+
+		const ImageParams params{nx,
+		                         ny,
+		                         nz,
+		                         bedParams.length_x,
+		                         bedParams.length_y,
+		                         length_z,
+		                         bedParams.off_x,
+		                         bedParams.off_y,
+		                         start_z + 0.5f * length_z};
+		auto stitchedImage = std::make_unique<ImageOwned>(params);
+		stitchedImage->allocate();
+		float* stitched = stitchedImage->getRawPointer();
+
+		const size_t sliceSize = static_cast<size_t>(nx) * ny;
+
+#pragma omp parallel for num_threads(globals::getNumThreads())
+		for (int z = 0; z < nz; z++)
+		{
+			float* stitchedSlice = stitched + z * sliceSize;
+			std::fill(stitchedSlice, stitchedSlice + sliceSize, 0.0f);
+			const float sliceCenter_z = start_z + (z + 0.5f) * vz;
+
+			float totalWeight = 0.0f;
+			for (size_t bed_i = 0; bed_i < bedImages.size(); bed_i++)
+			{
+				const float bedCenter_z =
+				    bedParams.off_z + bedPositions_z[bed_i];
+				const float distance = std::abs(sliceCenter_z - bedCenter_z);
+				if (distance >= halfLength_z)
+				{
+					continue;
+				}
+				const float weight = 1.0f - distance / halfLength_z;
+
+				// Linear interpolation between the two nearest bed slices
+				const float bedSlice = std::clamp(
+				    (sliceCenter_z - bedCenter_z + halfLength_z) / vz - 0.5f,
+				    0.0f, static_cast<float>(bedNz - 1));
+				const int slice0 = std::min(static_cast<int>(bedSlice),
+				                            std::max(bedNz - 2, 0));
+				const int slice1 = std::min(slice0 + 1, bedNz - 1);
+				const float fraction1 = bedSlice - static_cast<float>(slice0);
+
+				const float* bedData = bedImages[bed_i]->getRawPointer();
+				const float* bedSlice0 = bedData + slice0 * sliceSize;
+				const float* bedSlice1 = bedData + slice1 * sliceSize;
+				for (size_t i = 0; i < sliceSize; i++)
+				{
+					stitchedSlice[i] +=
+					    weight * ((1.0f - fraction1) * bedSlice0[i] +
+					              fraction1 * bedSlice1[i]);
+				}
+				totalWeight += weight;
+			}
+
+			if (totalWeight > 0.0f)
+			{
+				for (size_t i = 0; i < sliceSize; i++)
+				{
+					stitchedSlice[i] /= totalWeight;
+				}
+			}
+		}
+
+		return stitchedImage;
+	}
+}  // namespace yrt::petsird
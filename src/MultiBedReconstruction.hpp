@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Reconstruction.hpp"
+
+#include "yrt-pet/datastruct/image/Image.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird
+{
+	/*
+	 * Reconstructs the beds of a step-and-shoot acquisition (one PETSIRD
+	 *  file per bed, all on the same scanner) and stitches them into one
+	 *  image.
+	 *
+	 * - Each bed is reconstructed in the scanner's frame, with the image
+	 *    parameters of the options, into its own image ("_bed<i>" suffix).
+	 *    The beds therefore share the converted scanner, the normalisation
+	 *    and the sensitivity images
+	 * - The axial position of a bed (the position of the scanner's center
+	 *    along the bed, in mm) is given, or taken from the bed's movement
+	 *    time blocks. The bed must not move during its acquisition
+	 * - Up to numParallelBeds beds are ingested and reconstructed at the
+	 *    same time. The threads of the process are split between them
+	 * - The stitched image is written to the output image of the options
+	 * */
+	void runMultiBedReconstruction(const std::vector<std::string>& bed_fnames,
+	                               const std::vector<float>& bedPositions_z,
+	                               const ReconstructionOptions& options,
+	                               size_t numParallelBeds,
+	                               std::chrono::milliseconds progressInterval,
+	                               const std::string& profile_fname = "");
+
+	// Stitches the bed images (all with the same parameters) centered on
+	//  the given axial offsets from their parameters' offset. The images
+	//  are resampled linearly along Z. Where beds overlap, each bed is
+	//  weighted by its axial sensitivity profile, approximated by a
+	//  triangle that peaks at the center of the bed and vanishes at its
+	//  edges
+	std::unique_ptr<ImageOwned>
+	    stitchBedImages(const std::vector<const Image*>& bedImages,
+	                    const std::vector<float>& bedPositions_z);
+}  // namespace yrt::petsird
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "yrt-pet/utils/Globals.hpp"
+
+namespace yrt::petsird
+{
+	// Sets the number of threads of the process for the lifetime of the
+	//  object
+	class NumThreadsScope
+	{
+	public:
+		explicit NumThreadsScope(int numThreads)
+		    : m_previousNumThreads(globals::getNumThreads())
+		{
+			globals::setNumThreads(numThreads);
+		}
+		~NumThreadsScope() { globals::setNumThreads(m_previousNumThreads); }
+
+		NumThreadsScope(const NumThreadsScope&) = delete;
+		NumThreadsScope& operator=(const NumThreadsScope&) = delete;
+
+	private:
+		int m_previousNumThreads;
+	};
+}  // namespace yrt::petsird
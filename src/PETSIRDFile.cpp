@@ -0,0 +1,53 @@
+#include "PETSIRDFile.hpp"
+
+#include "ProgressReporter.hpp"
+#include "Tracer.hpp"
+
+#include <iterator>
+
+namespace yrt::petsird
+{
+	PETSIRDFile::PETSIRDFile(const std::string& fname)
+	    : m_fname(fname), m_reader(fname)
+	{
+		const TraceSpan span{"PETSIRD reader: header"};
+		m_reader.ReadHeader(m_header);
+	}
+
+	const std::string& PETSIRDFile::getFilename() const
+	{
+		return m_fname;
+	}
+
+	const ::petsird::Header& PETSIRDFile::getHeader() const
+	{
+		return m_header;
+	}
+
+	bool PETSIRDFile::readTimeBlocks(TimeBlockCollection& batch)
+	{
+		const TraceSpan span{"PETSIRD reader: time blocks"};
+		return m_reader.ReadTimeBlocks(batch);
+	}
+
+	TimeBlockCollection
+	    PETSIRDFile::readAllTimeBlocks(ProgressReporter* pp_progress)
+	{
+		constexpr size_t TimeBlocksPerBatch = 4096;
+
+		TimeBlockCollection timeBlocks;
+		TimeBlockCollection batch;
+		batch.reserve(TimeBlocksPerBatch);
+		while (readTimeBlocks(batch))
+		{
+			timeBlocks.insert(timeBlocks.end(),
+			                  std::make_move_iterator(batch.begin()),
+			                  std::make_move_iterator(batch.end()));
+			if (pp_progress != nullptr)
+			{
+				pp_progress->addProgress(0, batch.size(), 0);
+			}
+		}
+		return timeBlocks;
+	}
+}  // namespace yrt::petsird
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include "petsird/binary/protocols.h"
+
+#include <string>
+
+namespace yrt::petsird
+{
+	class ProgressReporter;
+
+	// PETSIRD binary file opened for reading. The header is read on opening
+	//  and the time blocks are then read in order
+	class PETSIRDFile
+	{
+	public:
+		explicit PETSIRDFile(const std::string& fname);
+
+		const std::string& getFilename() const;
+		const ::petsird::Header& getHeader() const;
+
+		// Reads the next batch of time blocks, at most the capacity of the
+		//  given collection. Returns false when there are no more blocks
+		bool readTimeBlocks(TimeBlockCollection& batch);
+		// Reads all the remaining time blocks. The blocks read are counted
+		//  in the progress reporter, if given
+		TimeBlockCollection
+		    readAllTimeBlocks(ProgressReporter* pp_progress = nullptr);
+
+	private:
+		std::string m_fname;
+		::petsird::binary::PETSIRDReader m_reader;
+		::petsird::Header m_header;
+	};
+}  // namespace yrt::petsird
@@ -1,94 +1,382 @@
 #include "PETSIRDListMode.hpp"
 
+#include "ListModeLUTWriter.hpp"
+#include "PETSIRDFile.hpp"
+#include "ProgressReporter.hpp"
+#include "RadixSort.hpp"
+#include "ScannerContext.hpp"
+#include "TimeBlockPool.hpp"
+#include "Tracer.hpp"
+#include "yrt-pet/datastruct/projection/BinIterator.hpp"
+#include "yrt-pet/utils/Globals.hpp"
+
 #include <petsird_helpers.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 namespace yrt::petsird
 {
+	namespace
+	{
+		// M_PI is not standard C++
+		constexpr float Pi = 3.14159265358979f;
+
+		// SplitMix64 finalizer
+		uint64_t mixBits(uint64_t x)
+		{
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+			return x ^ (x >> 31);
+		}
+
+		// Index in the stream of the event kept in the stratum
+		uint64_t getSampledStreamIndex(uint64_t stratum, uint64_t stride)
+		{
+			return stratum * stride + mixBits(stratum) % stride;
+		}
+
+		bool isEventSampled(uint64_t streamIndex, uint64_t stride)
+		{
+			return stride == 1 ||
+			       getSampledStreamIndex(streamIndex / stride, stride) ==
+			           streamIndex;
+		}
+
+		// Number of kept events in the range [begin, end) of the stream. Only
+		//  the first and last strata can be partially in the range
+		uint64_t countSampledEvents(uint64_t begin, uint64_t end,
+		                            uint64_t stride)
+		{
+			if (stride == 1 || begin >= end)
+			{
+				return end - std::min(begin, end);
+			}
+			const uint64_t firstStratum = begin / stride;
+			const uint64_t lastStratum = (end - 1) / stride;
+			const auto isInRange = [begin, end, stride](uint64_t stratum)
+			{
+				const uint64_t streamIndex =
+				    getSampledStreamIndex(stratum, stride);
+				return streamIndex >= begin && streamIndex < end;
+			};
+			if (firstStratum == lastStratum)
+			{
+				return isInRange(firstStratum) ? 1 : 0;
+			}
+			return (lastStratum - firstStratum - 1) +
+			       (isInRange(firstStratum) ? 1 : 0) +
+			       (isInRange(lastStratum) ? 1 : 0);
+		}
+	}  // namespace
+
 	PETSIRDListMode::PETSIRDListMode(
-	    const Scanner& pr_scanner,
-	    const ::petsird::ScannerInformation& pr_scannerInfo,
-	    const DetectorCorrespondenceMap& pr_correspondence,
-	    const TimeBlockCollection& pr_timeBlocks, bool useTOF)
-	    : ListMode(pr_scanner),
-	      mr_correspondence(pr_correspondence),
-	      mr_scannerInfo(pr_scannerInfo),
+	    std::shared_ptr<const ScannerContext> pp_scannerContext,
+	    const TimeBlockCollection& pr_timeBlocks, bool useTOF,
+	    const EventStorageOptions& storage)
+	    : ListMode(pp_scannerContext->getScanner()),
+	      mp_scannerContext(std::move(pp_scannerContext)),
+	      m_eventAllocator(
+	          std::make_shared<const EventStorageOptions>(storage)),
+	      m_timestamps(m_eventAllocator),
+	      m_d0s(m_eventAllocator),
+	      m_d1s(m_eventAllocator),
+	      m_tofs(m_eventAllocator),
+	      m_multiplicities(m_eventAllocator),
 	      m_useTOF(useTOF)
 	{
 		readTimeBlocks(pr_timeBlocks);
 	}
 
-	void PETSIRDListMode::readTimeBlocks(const TimeBlockCollection& timeBlocks)
+	void PETSIRDListMode::readTimeBlocks(const TimeBlockCollection& timeBlocks,
+	                                     ProgressReporter* pp_progress)
 	{
-		// TODO: Increase capacity of the std::vectors to increase performance
-
-		// const size_t numEventsEstimate = ???
-		// m_timestamps.reserve(numEventsEstimate);
-		// m_d0s.reserve(numEventsEstimate);
-		// m_d1s.reserve(numEventsEstimate);
-
 		const size_t numTimeBlocks = timeBlocks.size();
-		timestamp_t currentTime{};
 
+		// The new events do not belong to any subset of the partition, nor
+		//  to any gate
+		m_subsetBoundaries.clear();
+		m_gateBoundaries.clear();
+		m_motionSegmentStarts.clear();
+		m_motionSegmentStates.clear();
+
+		// First pass: Count the events of each time block to know where each
+		//  block's events go
+		TraceSpan countSpan{"readTimeBlocks: count events"};
+		std::vector<size_t>& eventOffsets = m_eventOffsets;
+		std::vector<uint64_t>& streamOffsets = m_streamOffsets;
+		eventOffsets.resize(numTimeBlocks + 1);
+		streamOffsets.resize(numTimeBlocks + 1);
+		eventOffsets[0] = count();
+		streamOffsets[0] = m_numStreamEvents;
+		bool hasNewMovements = false;
 		for (size_t timeBlock_i = 0; timeBlock_i < numTimeBlocks; timeBlock_i++)
 		{
+			size_t numEventsInBlock = 0;
 			const auto& timeBlock = timeBlocks[timeBlock_i];
 			if (std::holds_alternative<::petsird::EventTimeBlock>(timeBlock))
 			{
-				const auto& eventTimeBlock =
-				    std::get<::petsird::EventTimeBlock>(timeBlock);
-				currentTime = eventTimeBlock.time_interval.start;
+				numEventsInBlock = getNumPromptEvents(
+				    std::get<::petsird::EventTimeBlock>(timeBlock));
+			}
+			else if (std::holds_alternative<::petsird::ExternalSignalTimeBlock>(
+			             timeBlock))
+			{
+				// Signal blocks are small and rare compared to event blocks
+				m_signalBlocks.push_back(
+				    std::get<::petsird::ExternalSignalTimeBlock>(timeBlock));
+			}
+			else if (std::holds_alternative<::petsird::BedMovementTimeBlock>(
+			             timeBlock))
+			{
+				m_bedMovements.push_back(
+				    std::get<::petsird::BedMovementTimeBlock>(timeBlock));
+				hasNewMovements = true;
+			}
+			else if (std::holds_alternative<
+			             ::petsird::GantryMovementTimeBlock>(timeBlock))
+			{
+				m_gantryMovements.push_back(
+				    std::get<::petsird::GantryMovementTimeBlock>(timeBlock));
+				hasNewMovements = true;
+			}
+			streamOffsets[timeBlock_i + 1] =
+			    streamOffsets[timeBlock_i] + numEventsInBlock;
+			eventOffsets[timeBlock_i + 1] =
+			    eventOffsets[timeBlock_i] +
+			    countSampledEvents(streamOffsets[timeBlock_i],
+			                       streamOffsets[timeBlock_i + 1],
+			                       m_subsamplingStride);
+		}
+		m_numStreamEvents = streamOffsets[numTimeBlocks];
+		countSpan.end();
+
+		if (hasNewMovements)
+		{
+			m_motionStates =
+			    computeMotionStates(m_bedMovements, m_gantryMovements);
+		}
 
-				// Here we only accumulate prompt events
-				const auto& promptEvents = eventTimeBlock.prompt_events;
+		const size_t totalNumEvents = eventOffsets[numTimeBlocks];
+		m_timestamps.resize(totalNumEvents);
+		m_d0s.resize(totalNumEvents);
+		m_d1s.resize(totalNumEvents);
+		if (m_useTOF)
+		{
+			m_tofs.resize(totalNumEvents);
+		}
+		if (isCoalesced())
+		{
+			m_multiplicities.resize(totalNumEvents, 1);
+		}
 
-				const size_t numTypesOfModules = promptEvents.size();
+		// Second pass: Decode the time blocks in parallel, each into its
+		//  slice of the event arrays. An exception cannot leave the OpenMP
+		//  loop, so the first one is kept and rethrown after the loop
+		std::exception_ptr decodeError;
+		const int64_t numTimeBlocks_i = static_cast<int64_t>(numTimeBlocks);
 
-				for (::petsird::TypeOfModule mtype0 = 0;
-				     mtype0 < numTypesOfModules; mtype0++)
+#pragma omp parallel for num_threads(globals::getNumThreads()) \
+    schedule(dynamic, 1)
+		for (int64_t timeBlock_i = 0; timeBlock_i < numTimeBlocks_i;
+		     timeBlock_i++)
+		{
+			const auto& timeBlock = timeBlocks[timeBlock_i];
+			if (!std::holds_alternative<::petsird::EventTimeBlock>(timeBlock))
+			{
+				continue;
+			}
+			try
+			{
+				const TraceSpan decodeSpan{"readTimeBlocks: decode block"};
+				decodeEventTimeBlock(
+				    std::get<::petsird::EventTimeBlock>(timeBlock),
+				    eventOffsets[timeBlock_i], streamOffsets[timeBlock_i]);
+				if (pp_progress != nullptr)
+				{
+#if defined(_OPENMP)
+					const int thread_i = omp_get_thread_num();
+#else
+					const int thread_i = 0;
+#endif
+					pp_progress->addProgress(
+					    thread_i, 1,
+					    eventOffsets[timeBlock_i + 1] -
+					        eventOffsets[timeBlock_i]);
+				}
+			}
+			catch (...)
+			{
+#pragma omp critical
 				{
-					const auto& promptEvents_mtype0 = promptEvents[mtype0];
+					if (decodeError == nullptr)
+					{
+						decodeError = std::current_exception();
+					}
+				}
+			}
+		}
 
-					if (promptEvents_mtype0.size() != numTypesOfModules)
+		if (decodeError != nullptr)
+		{
+			std::rethrow_exception(decodeError);
+		}
+	}
+
+	size_t PETSIRDListMode::readTimeBlocks(PETSIRDFile& pr_file,
+	                                       TimeBlockPool& pr_pool,
+	                                       ProgressReporter* pp_progress,
+	                                       ListModeLUTWriter* pp_writer)
+	{
+		TimeBlockCollection batch = pr_pool.acquire();
+		size_t numTimeBlocks = 0;
+		while (pr_file.readTimeBlocks(batch))
+		{
+			const size_t numEventsBefore = count();
+			readTimeBlocks(batch, pp_progress);
+			numTimeBlocks += batch.size();
+			if (pp_writer != nullptr)
+			{
+				// Written while the batch's events are still in the cache
+				pp_writer->writeEvents(*this, numEventsBefore, count());
+			}
+		}
+		pr_pool.release(std::move(batch));
+		return numTimeBlocks;
+	}
+
+	void PETSIRDListMode::setEventSubsampling(float fraction)
+	{
+		if (!(fraction > 0.0f && fraction <= 1.0f))
+		{
+			throw std::invalid_argument(
+			    "The subsampling fraction must be in (0, 1]");
+		}
+		if (m_numStreamEvents > 0)
+		{
+			throw std::logic_error(
+			    "The subsampling must be set before reading events");
+		}
+		m_subsamplingStride =
+		    std::max<uint64_t>(std::llround(1.0 / fraction), 1);
+	}
+
+	uint64_t PETSIRDListMode::getNumStreamEvents() const
+	{
+		return m_numStreamEvents;
+	}
+
+	size_t PETSIRDListMode::getNumPromptEvents(
+	    const ::petsird::EventTimeBlock& eventTimeBlock)
+	{
+		// Here we only accumulate prompt events
+		const auto& promptEvents = eventTimeBlock.prompt_events;
+		const size_t numTypesOfModules = promptEvents.size();
+
+		size_t numEvents = 0;
+		for (const auto& promptEvents_mtype0 : promptEvents)
+		{
+			if (promptEvents_mtype0.size() != numTypesOfModules)
+			{
+				throw std::runtime_error(
+				    "File is not properly formed: The number of module "
+				    "types is not consistent in the list-mode events.");
+			}
+			for (const auto& promptEvents_mtype01 : promptEvents_mtype0)
+			{
+				numEvents += promptEvents_mtype01.size();
+			}
+		}
+		return numEvents;
+	}
+
+	void PETSIRDListMode::decodeEventTimeBlock(
+	    const ::petsird::EventTimeBlock& eventTimeBlock, size_t firstEventId,
+	    uint64_t firstStreamIndex)
+	{
+		const ::petsird::ScannerInformation& scannerInfo =
+		    mp_scannerContext->getScannerInformation();
+		const DetectorCorrespondenceMap& correspondence =
+		    mp_scannerContext->getCorrespondenceMap();
+		const timestamp_t currentTime = eventTimeBlock.time_interval.start;
+		const auto& promptEvents = eventTimeBlock.prompt_events;
+		const size_t numTypesOfModules = promptEvents.size();
+
+		size_t evId = firstEventId;
+		uint64_t streamIndex = firstStreamIndex;
+		for (::petsird::TypeOfModule mtype0 = 0; mtype0 < numTypesOfModules;
+		     mtype0++)
+		{
+			for (::petsird::TypeOfModule mtype1 = 0; mtype1 < numTypesOfModules;
+			     mtype1++)
+			{
+				const auto& promptEvents_mtype01 = promptEvents[mtype0][mtype1];
+				const size_t pairFirstEventId = evId;
+				const uint64_t pairFirstStreamIndex = streamIndex;
+				for (const auto& promptEvent : promptEvents_mtype01)
+				{
+					if (!isEventSampled(streamIndex++, m_subsamplingStride))
 					{
-						throw std::runtime_error(
-						    "File is not properly formed: The number of module "
-						    "types is not consistent in the list-mode events.");
+						continue;
 					}
 
-					for (::petsird::TypeOfModule mtype1 = 0;
-					     mtype1 < numTypesOfModules; mtype1++)
+					// Detector pair
+					auto [d0_expanded, d1_expanded] =
+					    petsird_helpers::expand_detection_bin_pair(
+					        scannerInfo, {mtype0, mtype1},
+					        promptEvent.detection_bins);
+					det_id_t d0flatIdx = correspondence.getFlatIndex(
+					    mtype0, d0_expanded.module_index,
+					    d0_expanded.element_index);
+					det_id_t d1flatIdx = correspondence.getFlatIndex(
+					    mtype1, d1_expanded.module_index,
+					    d1_expanded.element_index);
+
+					m_timestamps[evId] = currentTime;
+					m_d0s[evId] = d0flatIdx;
+					m_d1s[evId] = d1flatIdx;
+					evId++;
+				}
+
+				if (!m_useTOF)
+				{
+					continue;
+				}
+
+				// TOF values: A lookup of the bin centers by TOF index, in a
+				//  separate loop so that it vectorizes (as a gather)
+				const float* tofBinCenters =
+				    mp_scannerContext->getTOFBinCenters(mtype0, mtype1).data();
+				float* tofs = m_tofs.data() + pairFirstEventId;
+				const size_t numEventsInPair = promptEvents_mtype01.size();
+				if (m_subsamplingStride == 1)
+				{
+					for (size_t i = 0; i < numEventsInPair; i++)
 					{
-						const auto& promptEvents_mtype01 =
-						    promptEvents_mtype0[mtype1];
-						for (const auto& promptEvent : promptEvents_mtype01)
+						tofs[i] =
+						    tofBinCenters[promptEvents_mtype01[i].tof_idx];
+					}
+				}
+				else
+				{
+					size_t tof_i = 0;
+					for (size_t i = 0; i < numEventsInPair; i++)
+					{
+						if (isEventSampled(pairFirstStreamIndex + i,
+						                   m_subsamplingStride))
 						{
-							// Detector pair
-							auto [d0_expanded, d1_expanded] =
-							    petsird_helpers::expand_detection_bin_pair(
-							        mr_scannerInfo, {mtype0, mtype1},
-							        promptEvent.detection_bins);
-							det_id_t d0flatIdx = mr_correspondence.getFlatIndex(
-							    mtype0, d0_expanded.module_index,
-							    d0_expanded.element_index);
-							det_id_t d1flatIdx = mr_correspondence.getFlatIndex(
-							    mtype1, d1_expanded.module_index,
-							    d1_expanded.element_index);
-
-							// TOF value
-							const float tofValue_mm =
-							    0.5f *
-							    (mr_scannerInfo.tof_bin_edges[mtype0][mtype1]
-							         .edges[promptEvent.tof_idx + 1] +
-							     mr_scannerInfo.tof_bin_edges[mtype0][mtype1]
-							         .edges[promptEvent.tof_idx]);  // in mm
-							const float tofValue_ps =
-							    tofValue_mm * 2.0f / 0.299f;  // in ps
-
-							// Add to the cumulative vectors
-							m_timestamps.emplace_back(currentTime);
-							m_d0s.emplace_back(d0flatIdx);
-							m_d1s.emplace_back(d1flatIdx);
-							m_tofs.emplace_back(tofValue_ps);
+							tofs[tof_i++] =
+							    tofBinCenters[promptEvents_mtype01[i].tof_idx];
 						}
 					}
 				}
@@ -96,6 +384,768 @@ namespace yrt::petsird
 		}
 	}
 
+	size_t PETSIRDListMode::cullEventsOutsideFOV(const ImageParams& params)
+	{
+		// Cylinder around the image's box
+		const float center_x = params.off_x;
+		const float center_y = params.off_y;
+		const float radius2 =
+		    0.25f * (params.length_x * params.length_x +
+		             params.length_y * params.length_y);
+		const float min_z = params.off_z - 0.5f * params.length_z;
+		const float max_z = params.off_z + 0.5f * params.length_z;
+
+		// Detector positions as separate arrays, for the vectorized loop
+		const std::vector<Vector3D> detPositions = getDetectorPositions();
+		const size_t numDets = detPositions.size();
+		std::vector<float> detXs(numDets), detYs(numDets), detZs(numDets);
+		for (size_t d = 0; d < numDets; d++)
+		{
+			detXs[d] = detPositions[d].x;
+			detYs[d] = detPositions[d].y;
+			detZs[d] = detPositions[d].z;
+		}
+
+		const auto transformPoint = [](const transform_t& t, float& x,
+		                               float& y, float& z)
+		{
+			const float tx = t.r00 * x + t.r01 * y + t.r02 * z + t.tx;
+			const float ty = t.r10 * x + t.r11 * y + t.r12 * z + t.ty;
+			const float tz = t.r20 * x + t.r21 * y + t.r22 * z + t.tz;
+			x = tx;
+			y = ty;
+			z = tz;
+		};
+
+		const size_t numEvents = count();
+		const bool withMotion = hasMotion();
+		std::vector<uint8_t> keep(numEvents);
+
+#pragma omp parallel for num_threads(globals::getNumThreads())
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			const det_id_t d0 = m_d0s[evId];
+			const det_id_t d1 = m_d1s[evId];
+			float x0 = detXs[d0], y0 = detYs[d0], z0 = detZs[d0];
+			float x1 = detXs[d1], y1 = detYs[d1], z1 = detZs[d1];
+			if (withMotion)
+			{
+				const transform_t& transform =
+				    m_motionStates[findMotionState(m_motionStates,
+				                                   m_timestamps[evId])]
+				        .transform;
+				transformPoint(transform, x0, y0, z0);
+				transformPoint(transform, x1, y1, z1);
+			}
+
+			// Points x0 + t * (x1 - x0) with t in [0, 1]. Range of t inside
+			//  the circle (roots of a * t^2 + b * t + c = 0)
+			const float dx = x1 - x0;
+			const float dy = y1 - y0;
+			const float dz = z1 - z0;
+			const float fx = x0 - center_x;
+			const float fy = y0 - center_y;
+			const float a = std::max(dx * dx + dy * dy, 1e-12f);
+			const float b = 2.0f * (fx * dx + fy * dy);
+			const float c = fx * fx + fy * fy - radius2;
+			const float discriminant = b * b - 4.0f * a * c;
+			const float sqrtDiscriminant =
+			    std::sqrt(std::max(discriminant, 0.0f));
+			float tMin = std::max((-b - sqrtDiscriminant) / (2.0f * a), 0.0f);
+			float tMax = std::min((-b + sqrtDiscriminant) / (2.0f * a), 1.0f);
+
+			// Range of t between the two axial planes
+			if (std::abs(dz) > 1e-6f)
+			{
+				const float tz0 = (min_z - z0) / dz;
+				const float tz1 = (max_z - z0) / dz;
+				tMin = std::max(tMin, std::min(tz0, tz1));
+				tMax = std::min(tMax, std::max(tz0, tz1));
+			}
+			else if (z0 < min_z || z0 > max_z)
+			{
+				tMax = -1.0f;
+			}
+
+			keep[evId] = discriminant >= 0.0f && tMin <= tMax;
+		}
+
+		// Keep the remaining events in their order
+		std::vector<size_t> permutation;
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			if (keep[evId])
+			{
+				permutation.push_back(evId);
+			}
+		}
+		if (permutation.size() < numEvents)
+		{
+			applyPermutation(permutation);
+			m_subsetBoundaries.clear();
+			m_gateBoundaries.clear();
+		}
+		return count();
+	}
+
+	void PETSIRDListMode::sortEventsByLORLocality(int numSubsets)
+	{
+		const std::vector<uint64_t> keys = computeLORLocalityKeys();
+		const std::vector<size_t> subsetBoundaries =
+		    getSubsetBoundaries(numSubsets);
+
+		std::vector<size_t> permutation(count());
+		for (size_t i = 0; i < permutation.size(); i++)
+		{
+			permutation[i] = i;
+		}
+
+		// Sort each subset independently so that no event changes subset
+		const int numSubsetRanges =
+		    static_cast<int>(subsetBoundaries.size()) - 1;
+#pragma omp parallel for num_threads(globals::getNumThreads()) \
+    schedule(dynamic, 1)
+		for (int subset_i = 0; subset_i < numSubsetRanges; subset_i++)
+		{
+			std::sort(permutation.begin() + subsetBoundaries[subset_i],
+			          permutation.begin() + subsetBoundaries[subset_i + 1],
+			          [&keys](size_t a, size_t b)
+			          {
+				          return keys[a] < keys[b] ||
+				                 (keys[a] == keys[b] && a < b);
+			          });
+		}
+
+		applyPermutation(permutation);
+		if (!hasSubsetPartition(numSubsets))
+		{
+			// Events may have moved across the (equal) subsets, thus across
+			//  the gates
+			m_gateBoundaries.clear();
+		}
+	}
+
+	size_t PETSIRDListMode::coalesceDuplicateEvents(timestamp_t frameDuration)
+	{
+		const size_t numEvents = count();
+		if (numEvents == 0)
+		{
+			return 0;
+		}
+		if (numEvents > std::numeric_limits<uint32_t>::max())
+		{
+			throw std::runtime_error(
+			    "Too many events to coalesce in a single list-mode");
+		}
+
+		// Time frame of each event
+		std::vector<uint32_t> frames(numEvents, 0);
+		uint32_t numFrames = 1;
+		if (frameDuration > 0)
+		{
+			const timestamp_t firstTimestamp =
+			    *std::min_element(m_timestamps.begin(), m_timestamps.end());
+#pragma omp parallel for num_threads(globals::getNumThreads()) \
+    reduction(max : numFrames)
+			for (size_t evId = 0; evId < numEvents; evId++)
+			{
+				frames[evId] =
+				    (m_timestamps[evId] - firstTimestamp) / frameDuration;
+				numFrames = std::max(numFrames, frames[evId] + 1);
+			}
+		}
+
+		// Motion state of each event: An event is only merged with events
+		//  of the same state, which share its transform
+		std::vector<uint32_t> motionStates;
+		if (hasMotion())
+		{
+			motionStates.resize(numEvents);
+#pragma omp parallel for num_threads(globals::getNumThreads())
+			for (size_t evId = 0; evId < numEvents; evId++)
+			{
+				motionStates[evId] = static_cast<uint32_t>(
+				    findMotionState(m_motionStates, m_timestamps[evId]));
+			}
+		}
+
+		// The TOF value is a function of the TOF bin for a given detector
+		//  pair, so its bit pattern identifies the TOF bin
+		const auto getTOFBits = [this](uint32_t evId)
+		{
+			uint32_t tofBits;
+			std::memcpy(&tofBits, &m_tofs[evId], sizeof(tofBits));
+			return tofBits;
+		};
+
+		std::vector<uint32_t> indices(numEvents);
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			indices[evId] = static_cast<uint32_t>(evId);
+		}
+
+		// Least significant key first: TOF, second detector, first detector,
+		//  the frame and finally the motion state
+		if (m_useTOF)
+		{
+			radixSortIndices(indices, getTOFBits, 32);
+		}
+		radixSortIndices(
+		    indices, [this](uint32_t evId) { return m_d1s[evId]; }, 32);
+		radixSortIndices(
+		    indices, [this](uint32_t evId) { return m_d0s[evId]; }, 32);
+		if (numFrames > 1)
+		{
+			radixSortIndices(
+			    indices, [&frames](uint32_t evId) { return frames[evId]; },
+			    32);
+		}
+		if (!motionStates.empty())
+		{
+			radixSortIndices(
+			    indices,
+			    [&motionStates](uint32_t evId) { return motionStates[evId]; },
+			    32);
+		}
+
+		const auto isSameKey = [&](uint32_t a, uint32_t b)
+		{
+			return m_d0s[a] == m_d0s[b] && m_d1s[a] == m_d1s[b] &&
+			       frames[a] == frames[b] &&
+			       (motionStates.empty() ||
+			        motionStates[a] == motionStates[b]) &&
+			       (!m_useTOF || getTOFBits(a) == getTOFBits(b));
+		};
+
+		// The sort is stable, so the first event of each group is the
+		//  earliest one. It becomes the representative of the group and
+		//  holds the multiplicity
+		EventVector<uint32_t> multiplicities(numEvents, 0,
+		                                     m_eventAllocator);
+		size_t groupStart = 0;
+		for (size_t i = 1; i <= numEvents; i++)
+		{
+			if (i == numEvents || !isSameKey(indices[groupStart], indices[i]))
+			{
+				uint32_t multiplicity = 0;
+				for (size_t j = groupStart; j < i; j++)
+				{
+					multiplicity += getMultiplicity(indices[j]);
+				}
+				multiplicities[indices[groupStart]] = multiplicity;
+				groupStart = i;
+			}
+		}
+
+		// Keep the representatives in their original (acquisition) order
+		std::vector<size_t> permutation;
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			if (multiplicities[evId] > 0)
+			{
+				permutation.push_back(evId);
+			}
+		}
+		m_multiplicities = std::move(multiplicities);
+		applyPermutation(permutation);
+		m_subsetBoundaries.clear();
+		m_gateBoundaries.clear();
+
+		return count();
+	}
+
+	bool PETSIRDListMode::isCoalesced() const
+	{
+		return !m_multiplicities.empty();
+	}
+
+	uint32_t PETSIRDListMode::getMultiplicity(bin_t id) const
+	{
+		if (m_multiplicities.empty())
+		{
+			return 1;
+		}
+		return m_multiplicities[id];
+	}
+
+	std::vector<uint64_t> PETSIRDListMode::computeLORLocalityKeys() const
+	{
+		// Interleaves the 16 bits of the value with three zeros between
+		//  each bit
+		const auto spreadBits = [](uint64_t x)
+		{
+			x &= 0xFFFFull;
+			x = (x | (x << 24)) & 0x000000FF000000FFull;
+			x = (x | (x << 12)) & 0x000F000F000F000Full;
+			x = (x | (x << 6)) & 0x0303030303030303ull;
+			x = (x | (x << 3)) & 0x1111111111111111ull;
+			return x;
+		};
+
+		const std::vector<Vector3D> detPositions = getDetectorPositions();
+
+		// Bounding box of the detectors (which also bounds the LOR midpoints)
+		Vector3D minPos = detPositions.front();
+		Vector3D maxPos = detPositions.front();
+		for (const Vector3D& pos : detPositions)
+		{
+			minPos = {std::min(minPos.x, pos.x), std::min(minPos.y, pos.y),
+			          std::min(minPos.z, pos.z)};
+			maxPos = {std::max(maxPos.x, pos.x), std::max(maxPos.y, pos.y),
+			          std::max(maxPos.z, pos.z)};
+		}
+
+		constexpr float MaxQuantized = std::numeric_limits<uint16_t>::max();
+		const auto quantize = [MaxQuantized](float value, float minValue,
+		                                     float maxValue) -> uint64_t
+		{
+			const float range = maxValue - minValue;
+			if (range <= EPSILON)
+			{
+				return 0;
+			}
+			const float normalized =
+			    std::clamp((value - minValue) / range, 0.0f, 1.0f);
+			return static_cast<uint64_t>(normalized * MaxQuantized);
+		};
+
+		const size_t numEvents = count();
+		std::vector<uint64_t> keys(numEvents);
+
+#pragma omp parallel for num_threads(globals::getNumThreads())
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			const Vector3D& p0 = detPositions[m_d0s[evId]];
+			const Vector3D& p1 = detPositions[m_d1s[evId]];
+
+			// LORs are not oriented, use the direction with a positive Y
+			float dx = p1.x - p0.x;
+			float dy = p1.y - p0.y;
+			if (dy < 0.0f || (dy == 0.0f && dx < 0.0f))
+			{
+				dx = -dx;
+				dy = -dy;
+			}
+			const float phi = std::atan2(dy, dx);  // in [0, pi]
+
+			const uint64_t qx =
+			    quantize(0.5f * (p0.x + p1.x), minPos.x, maxPos.x);
+			const uint64_t qy =
+			    quantize(0.5f * (p0.y + p1.y), minPos.y, maxPos.y);
+			const uint64_t qz =
+			    quantize(0.5f * (p0.z + p1.z), minPos.z, maxPos.z);
+			const uint64_t qphi = quantize(phi, 0.0f, Pi);
+
+			keys[evId] = spreadBits(qx) | (spreadBits(qy) << 1) |
+			             (spreadBits(qz) << 2) | (spreadBits(qphi) << 3);
+		}
+
+		return keys;
+	}
+
+	void PETSIRDListMode::partitionSubsets(int numSubsets)
+	{
+		const size_t numEvents = count();
+		const size_t numSubsets_s =
+		    static_cast<size_t>(std::max(numSubsets, 1));
+		if (numEvents > std::numeric_limits<uint32_t>::max())
+		{
+			throw std::runtime_error(
+			    "Too many events to partition in a single list-mode");
+		}
+
+		// Azimuthal angle bin of each LOR
+		const std::vector<Vector3D> detPositions = getDetectorPositions();
+		const uint32_t numAngleBins = static_cast<uint32_t>(
+		    std::max<size_t>(getScanner().detsPerRing, 1));
+		std::vector<uint32_t> angleBins(numEvents);
+
+#pragma omp parallel for num_threads(globals::getNumThreads())
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			const Vector3D& p0 = detPositions[m_d0s[evId]];
+			const Vector3D& p1 = detPositions[m_d1s[evId]];
+			float phi = std::atan2(p1.y - p0.y, p1.x - p0.x);
+			if (phi < 0.0f)
+			{
+				phi += Pi;
+			}
+			angleBins[evId] = std::min(
+			    static_cast<uint32_t>(phi / Pi *
+			                          static_cast<float>(numAngleBins)),
+			    numAngleBins - 1);
+		}
+
+		// Deal the events of each angle bin to the subsets in turn
+		std::vector<uint32_t> indices(numEvents);
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			indices[evId] = static_cast<uint32_t>(evId);
+		}
+		// The angle bins are below numAngleBins, so only their significant
+		//  bits are sorted
+		int numAngleBinBits = 1;
+		while (numAngleBinBits < 32 &&
+		       (uint64_t{1} << numAngleBinBits) < numAngleBins)
+		{
+			numAngleBinBits++;
+		}
+		radixSortIndices(
+		    indices, [&angleBins](uint32_t evId) { return angleBins[evId]; },
+		    numAngleBinBits);
+
+		std::vector<uint32_t> subsets(numEvents);
+		std::vector<size_t> subsetSizes(numSubsets_s, 0);
+		if (isCoalesced())
+		{
+			// Balanced in counts: Each event goes to the subset with the
+			//  fewest counts so far, taken from a min-heap of (counts, subset)
+			using SubsetCount = std::pair<uint64_t, uint32_t>;
+			std::priority_queue<SubsetCount, std::vector<SubsetCount>,
+			                    std::greater<SubsetCount>>
+			    subsetCounts;
+			for (size_t subset_i = 0; subset_i < numSubsets_s; subset_i++)
+			{
+				subsetCounts.push({0, static_cast<uint32_t>(subset_i)});
+			}
+			for (size_t i = 0; i < numEvents; i++)
+			{
+				const auto [counts, subset_i] = subsetCounts.top();
+				subsetCounts.pop();
+				subsets[indices[i]] = subset_i;
+				subsetSizes[subset_i]++;
+				subsetCounts.push(
+				    {counts + m_multiplicities[indices[i]], subset_i});
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < numEvents; i++)
+			{
+				const size_t subset_i = i % numSubsets_s;
+				subsets[indices[i]] = static_cast<uint32_t>(subset_i);
+				subsetSizes[subset_i]++;
+			}
+		}
+
+		// Lay the subsets out contiguously, keeping the acquisition order
+		//  within each subset
+		std::vector<size_t> subsetBoundaries(numSubsets_s + 1, 0);
+		for (size_t subset_i = 0; subset_i < numSubsets_s; subset_i++)
+		{
+			subsetBoundaries[subset_i + 1] =
+			    subsetBoundaries[subset_i] + subsetSizes[subset_i];
+		}
+		std::vector<size_t> nextPosition(subsetBoundaries.begin(),
+		                                 subsetBoundaries.end() - 1);
+		std::vector<size_t> permutation(numEvents);
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			permutation[nextPosition[subsets[evId]]++] = evId;
+		}
+
+		applyPermutation(permutation);
+		m_subsetBoundaries = std::move(subsetBoundaries);
+		m_gateBoundaries.clear();
+	}
+
+	void PETSIRDListMode::placeEventsForReconstruction(int numSubsets)
+	{
+		const std::vector<size_t> subsetBoundaries =
+		    getSubsetBoundaries(numSubsets);
+		const int numSubsetRanges =
+		    static_cast<int>(subsetBoundaries.size()) - 1;
+
+		const auto place = [&subsetBoundaries, numSubsetRanges](auto& values)
+		{
+			if (values.empty())
+			{
+				return;
+			}
+			// Not written by the resize (See ScratchAllocator::construct)
+			std::remove_reference_t<decltype(values)> placed(
+			    values.get_allocator());
+			placed.resize(values.size());
+			for (int subset_i = 0; subset_i < numSubsetRanges; subset_i++)
+			{
+				const int64_t begin =
+				    static_cast<int64_t>(subsetBoundaries[subset_i]);
+				const int64_t end =
+				    static_cast<int64_t>(subsetBoundaries[subset_i + 1]);
+#pragma omp parallel for num_threads(globals::getNumThreads()) schedule(static)
+				for (int64_t i = begin; i < end; i++)
+				{
+					placed[i] = values[i];
+				}
+			}
+			values.swap(placed);
+		};
+
+		place(m_timestamps);
+		place(m_d0s);
+		place(m_d1s);
+		place(m_tofs);
+		place(m_multiplicities);
+	}
+
+	void PETSIRDListMode::applyGating(const GatingOptions& options)
+	{
+		const std::vector<uint32_t> gates =
+		    computeEventGates(m_signalBlocks, options, m_timestamps);
+		const size_t numGates = static_cast<size_t>(options.numGates);
+		const size_t numEvents = count();
+
+		// Stable counting sort by gate
+		std::vector<size_t> gateBoundaries(numGates + 1, 0);
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			if (gates[evId] != NO_GATE)
+			{
+				gateBoundaries[gates[evId] + 1]++;
+			}
+		}
+		for (size_t gate = 0; gate < numGates; gate++)
+		{
+			gateBoundaries[gate + 1] += gateBoundaries[gate];
+		}
+		std::vector<size_t> permutation(gateBoundaries[numGates]);
+		std::vector<size_t> nextPosition(gateBoundaries.begin(),
+		                                 gateBoundaries.end() - 1);
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			if (gates[evId] != NO_GATE)
+			{
+				permutation[nextPosition[gates[evId]]++] = evId;
+			}
+		}
+
+		applyPermutation(permutation);
+		m_subsetBoundaries.clear();
+		m_gateBoundaries = std::move(gateBoundaries);
+	}
+
+	size_t PETSIRDListMode::getNumGates() const
+	{
+		return m_gateBoundaries.empty() ? 0 : m_gateBoundaries.size() - 1;
+	}
+
+	std::pair<size_t, size_t> PETSIRDListMode::getGateRange(size_t gate) const
+	{
+		if (gate >= getNumGates())
+		{
+			throw std::out_of_range("Gate " + std::to_string(gate) +
+			                        " does not exist");
+		}
+		return {m_gateBoundaries[gate], m_gateBoundaries[gate + 1]};
+	}
+
+	const std::vector<::petsird::ExternalSignalTimeBlock>&
+	    PETSIRDListMode::getExternalSignalTimeBlocks() const
+	{
+		return m_signalBlocks;
+	}
+
+	void PETSIRDListMode::groupEventsByMotionState(int numSubsets)
+	{
+		if (!hasMotion())
+		{
+			return;
+		}
+
+		const std::vector<size_t> ranges =
+		    m_gateBoundaries.empty() ? getSubsetBoundaries(numSubsets) :
+		                               m_gateBoundaries;
+		const size_t numRanges = ranges.size() - 1;
+		const size_t numStates = m_motionStates.size();
+		const size_t numEvents = count();
+
+		std::vector<frame_t> states(numEvents);
+#pragma omp parallel for num_threads(globals::getNumThreads())
+		for (size_t evId = 0; evId < numEvents; evId++)
+		{
+			states[evId] = findMotionState(m_motionStates, m_timestamps[evId]);
+		}
+
+		// Stable counting sort by motion state within each range
+		std::vector<size_t> permutation(numEvents);
+		std::vector<size_t> segmentStarts;
+		std::vector<frame_t> segmentStates;
+		std::vector<size_t> nextPosition(numStates);
+		for (size_t range_i = 0; range_i < numRanges; range_i++)
+		{
+			const size_t rangeBegin = ranges[range_i];
+			const size_t rangeEnd = ranges[range_i + 1];
+
+			std::vector<size_t> stateCounts(numStates, 0);
+			for (size_t evId = rangeBegin; evId < rangeEnd; evId++)
+			{
+				stateCounts[states[evId]]++;
+			}
+			size_t position = rangeBegin;
+			for (size_t state = 0; state < numStates; state++)
+			{
+				nextPosition[state] = position;
+				if (stateCounts[state] > 0)
+				{
+					segmentStarts.push_back(position);
+					segmentStates.push_back(static_cast<frame_t>(state));
+				}
+				position += stateCounts[state];
+			}
+			for (size_t evId = rangeBegin; evId < rangeEnd; evId++)
+			{
+				permutation[nextPosition[states[evId]]++] = evId;
+			}
+		}
+
+		applyPermutation(permutation);
+		m_motionSegmentStarts = std::move(segmentStarts);
+		m_motionSegmentStates = std::move(segmentStates);
+	}
+
+	const std::vector<MotionState>& PETSIRDListMode::getMotionStates() const
+	{
+		return m_motionStates;
+	}
+
+	void PETSIRDListMode::setMotionCorrection(bool enabled)
+	{
+		m_motionCorrection = enabled;
+	}
+
+	bool PETSIRDListMode::hasMotion() const
+	{
+		return m_motionCorrection && !m_motionStates.empty();
+	}
+
+	size_t PETSIRDListMode::getNumFrames() const
+	{
+		if (!hasMotion())
+		{
+			return ListMode::getNumFrames();
+		}
+		return m_motionStates.size();
+	}
+
+	frame_t PETSIRDListMode::getFrame(bin_t id) const
+	{
+		if (!hasMotion())
+		{
+			return ListMode::getFrame(id);
+		}
+		if (!m_motionSegmentStarts.empty())
+		{
+			const size_t segment =
+			    std::upper_bound(m_motionSegmentStarts.begin(),
+			                     m_motionSegmentStarts.end(), id) -
+			    m_motionSegmentStarts.begin() - 1;
+			return m_motionSegmentStates[segment];
+		}
+		return findMotionState(m_motionStates, m_timestamps[id]);
+	}
+
+	transform_t PETSIRDListMode::getTransformOfFrame(frame_t frame) const
+	{
+		if (!hasMotion())
+		{
+			return ListMode::getTransformOfFrame(frame);
+		}
+		return m_motionStates.at(frame).transform;
+	}
+
+	bool PETSIRDListMode::hasSubsetPartition(int numSubsets) const
+	{
+		return !m_subsetBoundaries.empty() &&
+		       m_subsetBoundaries.size() ==
+		           static_cast<size_t>(std::max(numSubsets, 1)) + 1;
+	}
+
+	std::vector<Vector3D> PETSIRDListMode::getDetectorPositions() const
+	{
+		const Scanner& scanner = getScanner();
+		const size_t numDets = scanner.getNumDets();
+
+		std::vector<Vector3D> detPositions(numDets);
+		for (det_id_t d = 0; d < numDets; d++)
+		{
+			detPositions[d] = scanner.getDetectorPos(d);
+		}
+		return detPositions;
+	}
+
+	std::vector<size_t>
+	    PETSIRDListMode::getSubsetBoundaries(int numSubsets) const
+	{
+		if (hasSubsetPartition(numSubsets))
+		{
+			return m_subsetBoundaries;
+		}
+
+		const size_t numEvents = count();
+		const size_t numSubsets_s =
+		    static_cast<size_t>(std::max(numSubsets, 1));
+
+		std::vector<size_t> boundaries(numSubsets_s + 1);
+		for (size_t subset_i = 0; subset_i <= numSubsets_s; subset_i++)
+		{
+			boundaries[subset_i] = subset_i * numEvents / numSubsets_s;
+		}
+		return boundaries;
+	}
+
+	void PETSIRDListMode::applyPermutation(
+	    const std::vector<size_t>& permutation)
+	{
+		const auto permute = [&permutation](auto& values)
+		{
+			if (values.empty())
+			{
+				return;
+			}
+			std::remove_reference_t<decltype(values)> permuted(
+			    permutation.size(), values.get_allocator());
+			const size_t numValues = permutation.size();
+#pragma omp parallel for num_threads(globals::getNumThreads())
+			for (size_t i = 0; i < numValues; i++)
+			{
+				permuted[i] = values[permutation[i]];
+			}
+			values.swap(permuted);
+		};
+
+		// The events may have moved across the motion segments
+		m_motionSegmentStarts.clear();
+		m_motionSegmentStates.clear();
+
+		permute(m_timestamps);
+		permute(m_d0s);
+		permute(m_d1s);
+		permute(m_tofs);
+		permute(m_multiplicities);
+	}
+
+	std::unique_ptr<BinIterator>
+	    PETSIRDListMode::getBinIter(int numSubsets, int idxSubset) const
+	{
+		const std::vector<size_t> subsetBoundaries =
+		    getSubsetBoundaries(numSubsets);
+		const size_t idxStart = subsetBoundaries[idxSubset];
+		const size_t idxEnd = subsetBoundaries[idxSubset + 1];
+		if (idxEnd == idxStart)
+		{
+			throw std::runtime_error("Subset " + std::to_string(idxSubset) +
+			                         " contains no events");
+		}
+
+		// The reconstruction goes through the subset's events in order
+		prefetchEvents(m_d0s, idxStart, idxEnd);
+		prefetchEvents(m_d1s, idxStart, idxEnd);
+		prefetchEvents(m_tofs, idxStart, idxEnd);
+		prefetchEvents(m_multiplicities, idxStart, idxEnd);
+		// The end of the range is inclusive
+		return std::make_unique<BinIteratorRange>(idxStart, idxEnd - 1);
+	}
+
 	det_id_t PETSIRDListMode::getDetector1(bin_t id) const
 	{
 		return m_d0s[id];
@@ -111,6 +1161,31 @@ namespace yrt::petsird
 		return {m_d0s[id], m_d1s[id]};
 	}
 
+	const EventVector<timestamp_t>& PETSIRDListMode::getTimestampArray() const
+	{
+		return m_timestamps;
+	}
+
+	const EventVector<det_id_t>& PETSIRDListMode::getDetector1Array() const
+	{
+		return m_d0s;
+	}
+
+	const EventVector<det_id_t>& PETSIRDListMode::getDetector2Array() const
+	{
+		return m_d1s;
+	}
+
+	const EventVector<float>& PETSIRDListMode::getTOFArray() const
+	{
+		return m_tofs;
+	}
+
+	const EventVector<uint32_t>& PETSIRDListMode::getMultiplicityArray() const
+	{
+		return m_multiplicities;
+	}
+
 	size_t PETSIRDListMode::count() const
 	{
 		return m_d0s.size();
@@ -121,6 +1196,16 @@ namespace yrt::petsird
 		return m_timestamps[id];
 	}
 
+	float PETSIRDListMode::getProjectionValue(bin_t id) const
+	{
+		return static_cast<float>(getMultiplicity(id));
+	}
+
+	bool PETSIRDListMode::isUniform() const
+	{
+		return !isCoalesced();
+	}
+
 	bool PETSIRDListMode::hasTOF() const
 	{
 		return m_useTOF;
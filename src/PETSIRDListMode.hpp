@@ -1,22 +1,130 @@
 #pragma once
 
-#include "DetectorCorrespondenceMap.hpp"
+#include "Gating.hpp"
+#include "Motion.hpp"
+#include "ScratchAllocator.hpp"
 #include "utils.hpp"
+#include "yrt-pet/datastruct/image/ImageParams.hpp"
 #include "yrt-pet/datastruct/projection/ListMode.hpp"
 
+#include <memory>
+#include <utility>
+
 namespace yrt::petsird
 {
+	class ListModeLUTWriter;
+	class PETSIRDFile;
+	class ProgressReporter;
+	class ScannerContext;
+	class TimeBlockPool;
+
 	class PETSIRDListMode final : public ListMode
 	{
 	public:
-		PETSIRDListMode(const Scanner& pr_scanner,
-		                const ::petsird::ScannerInformation& pr_scannerInfo,
-		                const DetectorCorrespondenceMap& pr_correspondence,
-		                const TimeBlockCollection& pr_timeBlocks,
-		                bool useTOF = false);
+		// The list mode shares the ownership of the scanner context. The
+		//  storage options place the large event arrays in memory-mapped
+		//  files or in huge pages (See ScratchAllocator)
+		PETSIRDListMode(
+		    std::shared_ptr<const ScannerContext> pp_scannerContext,
+		    const TimeBlockCollection& pr_timeBlocks, bool useTOF = false,
+		    const EventStorageOptions& storage = {});
+
+		// Appends the events in the given time blocks into the list of events.
+		//  The time blocks are decoded in parallel. The decoded blocks and
+		//  events are counted in the progress reporter, if given
+		void readTimeBlocks(const TimeBlockCollection& timeBlocks,
+		                    ProgressReporter* pp_progress = nullptr);
+		// Reads and decodes the remaining time blocks of the file, one batch
+		//  at a time. The batches are taken from (and returned to) the pool.
+		//  The events of each batch are appended to the writer, if given, as
+		//  soon as they are decoded. Returns the number of time blocks read
+		size_t readTimeBlocks(PETSIRDFile& pr_file, TimeBlockPool& pr_pool,
+		                      ProgressReporter* pp_progress = nullptr,
+		                      ListModeLUTWriter* pp_writer = nullptr);
+
+		// Keeps only a deterministic, stratified subsample of the events that
+		//  are read: One event in every round(1 / fraction) consecutive
+		//  events of the stream, at a position given by a hash of the
+		//  stratum's index (The same file gives the same subsample). To set
+		//  before any event is read
+		void setEventSubsampling(float fraction);
+		// Number of prompt events in the time blocks read, including those
+		//  not kept by the subsampling
+		uint64_t getNumStreamEvents() const;
+
+		// Drops the events whose LOR (the segment between its two
+		//  detectors) does not cross the cylinder that bounds the image.
+		//  Under motion, the LORs are first moved into the bed's frame.
+		//  Returns the number of events left
+		size_t cullEventsOutsideFOV(const ImageParams& params);
+
+		// Reorders the events of each OSEM subset so that events with nearby
+		//  LORs (midpoint and direction) are contiguous in memory. The set of
+		//  events in each subset is unchanged
+		void sortEventsByLORLocality(int numSubsets);
+
+		// Merges the events that share the same detector pair and TOF bin
+		//  (within the same time frame and motion state) into one event whose
+		//  multiplicity is the number of merged events. A frame duration of
+		//  zero means that the whole acquisition is one frame. The events stay
+		//  in acquisition order, but there are fewer of them, so the subsets
+		//  split by event count differ and any subset partition is cleared.
+		//  Returns the number of events after the merge
+		size_t coalesceDuplicateEvents(timestamp_t frameDuration = 0);
+
+		// Permutes the events so that each OSEM subset is a contiguous range
+		//  of events. The subsets are balanced in number of events (in total
+		//  multiplicity once coalesced) and each one covers all the LOR
+		//  azimuthal angles. The partition is used by getBinIter when the
+		//  reconstruction uses the same number of subsets, and is
+		//  invalidated when events are added or coalesced
+		void partitionSubsets(int numSubsets);
+
+		// Moves the event arrays to new memory that is first written (which
+		//  places its pages on a NUMA node) by the thread that will read it
+		//  during the reconstruction. Like the projection loops, the events
+		//  of each subset are split statically between the threads. To call
+		//  once the events are in their final order
+		void placeEventsForReconstruction(int numSubsets);
 
-		// Appends the events in the given time blocks into the list of events
-		void readTimeBlocks(const TimeBlockCollection& timeBlocks);
+		// Assigns each event to a gate from the external signal time blocks
+		//  read so far, and permutes the events so that each gate is a
+		//  contiguous range of events (in acquisition order). The events
+		//  that no gate covers are dropped. Like the subset partition, the
+		//  gates are invalidated when events are added, coalesced or moved
+		//  to other subsets
+		void applyGating(const GatingOptions& options);
+		// Zero if the events are not gated
+		size_t getNumGates() const;
+		// Range [begin, end) of the events of the gate
+		std::pair<size_t, size_t> getGateRange(size_t gate) const;
+		const std::vector<::petsird::ExternalSignalTimeBlock>&
+		    getExternalSignalTimeBlocks() const;
+
+		// Stably reorders the events of each gate (or of each subset, if
+		//  the events are not gated) by motion state, so that each state is
+		//  a contiguous segment of events. getFrame then finds the state of
+		//  an event among the few segments instead of from its timestamp.
+		//  To call once the events are otherwise in their final order
+		void groupEventsByMotionState(int numSubsets);
+		// Motion states from the bed and gantry movement time blocks read
+		//  so far (Empty if there were none)
+		const std::vector<MotionState>& getMotionStates() const;
+		// When disabled, the motion states are kept but the list-mode does
+		//  not report any motion (Enabled by default)
+		void setMotionCorrection(bool enabled);
+		bool hasSubsetPartition(int numSubsets) const;
+		bool isCoalesced() const;
+		uint32_t getMultiplicity(bin_t id) const;
+
+		// Event arrays, indexed by event (for zero-copy access). The
+		//  multiplicities are empty if the list mode is not coalesced, and
+		//  the TOF values if it does not use TOF
+		const EventVector<timestamp_t>& getTimestampArray() const;
+		const EventVector<det_id_t>& getDetector1Array() const;
+		const EventVector<det_id_t>& getDetector2Array() const;
+		const EventVector<float>& getTOFArray() const;
+		const EventVector<uint32_t>& getMultiplicityArray() const;
 
 		det_id_t getDetector1(bin_t id) const override;
 		det_id_t getDetector2(bin_t id) const override;
@@ -24,18 +132,77 @@ namespace yrt::petsird
 		size_t count() const override;
 		timestamp_t getTimestamp(bin_t id) const override;
 
+		// Multiplicity of the event (1 if the list mode is not coalesced)
+		float getProjectionValue(bin_t id) const override;
+		bool isUniform() const override;
+
 		bool hasTOF() const override;
 		float getTOFValue(bin_t id) const override;
 
+		// The frames are the motion states, if the motion correction is
+		//  enabled
+		bool hasMotion() const override;
+		size_t getNumFrames() const override;
+		frame_t getFrame(bin_t id) const override;
+		transform_t getTransformOfFrame(frame_t frame) const override;
+
+		// Also prefetches the events of the subset when they are out-of-core
+		std::unique_ptr<BinIterator> getBinIter(int numSubsets,
+		                                        int idxSubset) const override;
+
 	private:
-		const DetectorCorrespondenceMap mr_correspondence;
-		const ::petsird::ScannerInformation& mr_scannerInfo;
-
-		std::vector<timestamp_t> m_timestamps;  // in ms
-		std::vector<det_id_t> m_d0s;            // index in the YRT-PET LUT
-		std::vector<det_id_t> m_d1s;            // index in the YRT-PET LUT
-		std::vector<float> m_tofs;              // in ps
-		                                        // TODO: Motion
+		// Number of prompt events in the time block (Also checks that the
+		//  block is well-formed)
+		static size_t
+		    getNumPromptEvents(const ::petsird::EventTimeBlock& eventTimeBlock);
+		// Decodes the prompts of the time block into the event arrays,
+		//  starting at the given event index. Only the events kept by the
+		//  subsampling are decoded (The first event of the block has the
+		//  given index in the stream)
+		void decodeEventTimeBlock(
+		    const ::petsird::EventTimeBlock& eventTimeBlock,
+		    size_t firstEventId, uint64_t firstStreamIndex);
+
+		// Index of the first event of each subset (plus the end index)
+		std::vector<size_t> getSubsetBoundaries(int numSubsets) const;
+		std::vector<Vector3D> getDetectorPositions() const;
+		// Reorders all the event arrays so that the new event i is the old
+		//  event permutation[i]
+		void applyPermutation(const std::vector<size_t>& permutation);
+		// 64-bit Morton code of the LOR's midpoint and azimuthal angle
+		std::vector<uint64_t> computeLORLocalityKeys() const;
+
+		std::shared_ptr<const ScannerContext> mp_scannerContext;
+
+		ScratchAllocator<uint8_t> m_eventAllocator;
+		EventVector<timestamp_t> m_timestamps;  // in ms
+		EventVector<det_id_t> m_d0s;            // index in the YRT-PET LUT
+		EventVector<det_id_t> m_d1s;            // index in the YRT-PET LUT
+		EventVector<float> m_tofs;              // in ps, empty without TOF
+		EventVector<uint32_t> m_multiplicities;  // Empty if not coalesced
+		// Computed by partitionSubsets (Empty if not partitioned)
+		std::vector<size_t> m_subsetBoundaries;
+		// Computed by applyGating (Empty if not gated)
+		std::vector<size_t> m_gateBoundaries;
+		// Trigger and physiological signal streams, kept for the gating
+		std::vector<::petsird::ExternalSignalTimeBlock> m_signalBlocks;
+		std::vector<::petsird::BedMovementTimeBlock> m_bedMovements;
+		std::vector<::petsird::GantryMovementTimeBlock> m_gantryMovements;
+		std::vector<MotionState> m_motionStates;
+		bool m_motionCorrection = true;
+		// Computed by groupEventsByMotionState (Empty if not grouped): The
+		//  first event and the motion state of each segment
+		std::vector<size_t> m_motionSegmentStarts;
+		std::vector<frame_t> m_motionSegmentStates;
+		// Index of the first event of each time block of the batch being
+		//  read (Kept to avoid an allocation per batch)
+		std::vector<size_t> m_eventOffsets;
+		// Index in the stream of the first event of each time block of the
+		//  batch being read
+		std::vector<uint64_t> m_streamOffsets;
+		// Number of consecutive events per kept event (1 keeps all events)
+		uint64_t m_subsamplingStride = 1;
+		uint64_t m_numStreamEvents = 0;
 		bool m_useTOF;
 	};
 }  // namespace yrt::petsird
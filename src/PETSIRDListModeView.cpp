@@ -0,0 +1,115 @@
+#include "PETSIRDListModeView.hpp"
+
+#include "PETSIRDListMode.hpp"
+#include "yrt-pet/datastruct/projection/BinIterator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace yrt::petsird
+{
+	PETSIRDListModeView::PETSIRDListModeView(const PETSIRDListMode& pr_parent,
+	                                         size_t begin, size_t end)
+	    : ListMode(pr_parent.getScanner()),
+	      mr_parent(pr_parent),
+	      m_begin(begin),
+	      m_end(end)
+	{
+		if (begin > end || end > pr_parent.count())
+		{
+			throw std::out_of_range("Invalid range of events for the view");
+		}
+	}
+
+	det_id_t PETSIRDListModeView::getDetector1(bin_t id) const
+	{
+		return mr_parent.getDetector1(m_begin + id);
+	}
+
+	det_id_t PETSIRDListModeView::getDetector2(bin_t id) const
+	{
+		return mr_parent.getDetector2(m_begin + id);
+	}
+
+	det_pair_t PETSIRDListModeView::getDetectorPair(bin_t id) const
+	{
+		return mr_parent.getDetectorPair(m_begin + id);
+	}
+
+	size_t PETSIRDListModeView::count() const
+	{
+		return m_end - m_begin;
+	}
+
+	timestamp_t PETSIRDListModeView::getTimestamp(bin_t id) const
+	{
+		return mr_parent.getTimestamp(m_begin + id);
+	}
+
+	float PETSIRDListModeView::getProjectionValue(bin_t id) const
+	{
+		return mr_parent.getProjectionValue(m_begin + id);
+	}
+
+	bool PETSIRDListModeView::isUniform() const
+	{
+		return mr_parent.isUniform();
+	}
+
+	bool PETSIRDListModeView::hasTOF() const
+	{
+		return mr_parent.hasTOF();
+	}
+
+	float PETSIRDListModeView::getTOFValue(bin_t id) const
+	{
+		return mr_parent.getTOFValue(m_begin + id);
+	}
+
+	bool PETSIRDListModeView::hasMotion() const
+	{
+		return mr_parent.hasMotion();
+	}
+
+	size_t PETSIRDListModeView::getNumFrames() const
+	{
+		return mr_parent.getNumFrames();
+	}
+
+	frame_t PETSIRDListModeView::getFrame(bin_t id) const
+	{
+		return mr_parent.getFrame(m_begin + id);
+	}
+
+	transform_t PETSIRDListModeView::getTransformOfFrame(frame_t frame) const
+	{
+		return mr_parent.getTransformOfFrame(frame);
+	}
+
+	std::unique_ptr<BinIterator>
+	    PETSIRDListModeView::getBinIter(int numSubsets, int idxSubset) const
+	{
+		const size_t numEvents = count();
+		const size_t numSubsets_s =
+		    static_cast<size_t>(std::max(numSubsets, 1));
+		const size_t idxStart = idxSubset * numEvents / numSubsets_s;
+		const size_t idxEnd = (idxSubset + 1) * numEvents / numSubsets_s;
+		if (idxEnd == idxStart)
+		{
+			throw std::runtime_error("Subset " + std::to_string(idxSubset) +
+			                         " contains no events");
+		}
+
+		prefetchEvents(mr_parent.getDetector1Array(), m_begin + idxStart,
+		               m_begin + idxEnd);
+		prefetchEvents(mr_parent.getDetector2Array(), m_begin + idxStart,
+		               m_begin + idxEnd);
+		prefetchEvents(mr_parent.getTOFArray(), m_begin + idxStart,
+		               m_begin + idxEnd);
+		prefetchEvents(mr_parent.getMultiplicityArray(), m_begin + idxStart,
+		               m_begin + idxEnd);
+		// The end of the range is inclusive
+		return std::make_unique<BinIteratorRange>(idxStart, idxEnd - 1);
+	}
+}  // namespace yrt::petsird
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "yrt-pet/datastruct/projection/ListMode.hpp"
+
+#include <memory>
+
+namespace yrt::petsird
+{
+	class PETSIRDListMode;
+
+	// Zero-copy list-mode over a contiguous range of the events of a
+	//  PETSIRDListMode (for example, one gate). The parent must outlive the
+	//  view and must not reorder its events while the view is in use
+	class PETSIRDListModeView final : public ListMode
+	{
+	public:
+		// Events [begin, end) of the parent
+		PETSIRDListModeView(const PETSIRDListMode& pr_parent, size_t begin,
+		                    size_t end);
+
+		det_id_t getDetector1(bin_t id) const override;
+		det_id_t getDetector2(bin_t id) const override;
+		det_pair_t getDetectorPair(bin_t id) const override;
+		size_t count() const override;
+		timestamp_t getTimestamp(bin_t id) const override;
+
+		float getProjectionValue(bin_t id) const override;
+		bool isUniform() const override;
+
+		bool hasTOF() const override;
+		float getTOFValue(bin_t id) const override;
+
+		bool hasMotion() const override;
+		size_t getNumFrames() const override;
+		frame_t getFrame(bin_t id) const override;
+		transform_t getTransformOfFrame(frame_t frame) const override;
+
+		// The subsets split the range in equal, chronological parts
+		std::unique_ptr<BinIterator> getBinIter(int numSubsets,
+		                                        int idxSubset) const override;
+
+	private:
+		const PETSIRDListMode& mr_parent;
+		size_t m_begin;
+		size_t m_end;
+	};
+}  // namespace yrt::petsird
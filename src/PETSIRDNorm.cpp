@@ -1,17 +1,16 @@
 #include "PETSIRDNorm.hpp"
 
+#include "ScannerContext.hpp"
+
 #include "petsird_helpers.h"
 #include "yrt-pet/datastruct/scanner/Scanner.hpp"
 
 namespace yrt::petsird
 {
 	PETSIRDNorm::PETSIRDNorm(
-	    const Scanner& pr_scanner,
-	    const ::petsird::ScannerInformation& pr_scannerInfo,
-	    const DetectorCorrespondenceMap& pr_correspondence)
-	    : yrt::Histogram3D(pr_scanner),
-	      mr_correspondence(pr_correspondence),
-	      mr_scannerInfo(pr_scannerInfo)
+	    std::shared_ptr<const ScannerContext> pp_scannerContext)
+	    : yrt::Histogram3D(pp_scannerContext->getScanner()),
+	      mp_scannerContext(std::move(pp_scannerContext))
 	{
 	}
 
@@ -22,26 +21,15 @@ namespace yrt::petsird
 		// TODO: implement this. But need to somehow have "histogram bins" be
 		//  the "detection_bin" that petsird defines
 
-		auto d1_tuple = mr_correspondence.getDetectorFromFlatIndex(detPair.d1);
-		auto d2_tuple = mr_correspondence.getDetectorFromFlatIndex(detPair.d2);
-
-		::petsird::ExpandedDetectionBin d1_expandedBin{};
-		d1_expandedBin.module_index = std::get<1>(d1_tuple);
-		d1_expandedBin.element_index = std::get<2>(d1_tuple);
-		// TODO: Support energy level
-		auto d1_bin = petsird_helpers::make_detection_bin(
-		    mr_scannerInfo, std::get<0>(d1_tuple), d1_expandedBin);
-
-		::petsird::ExpandedDetectionBin d2_expandedBin{};
-		d2_expandedBin.module_index = std::get<1>(d2_tuple);
-		d2_expandedBin.element_index = std::get<2>(d2_tuple);
-		// TODO: Support energy level
-		auto d2_bin = petsird_helpers::make_detection_bin(
-		    mr_scannerInfo, std::get<0>(d2_tuple), d2_expandedBin);
+		// TODO: Support energy level (The detection bins are at the first
+		//  energy bin)
+		const auto& types = mp_scannerContext->getDetectorTypes();
+		const auto& detectionBins = mp_scannerContext->getDetectionBins();
 
 		float sensitivity = petsird_helpers::get_detection_efficiency(
-		    mr_scannerInfo, {std::get<0>(d1_tuple), std::get<0>(d2_tuple)},
-		    d1_bin, d2_bin);
+		    mp_scannerContext->getScannerInformation(),
+		    {types[detPair.d1], types[detPair.d2]},
+		    detectionBins[detPair.d1], detectionBins[detPair.d2]);
 
 		return sensitivity;
 	}
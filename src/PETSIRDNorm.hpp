@@ -1,17 +1,20 @@
 #pragma once
 
-#include "DetectorCorrespondenceMap.hpp"
 #include "yrt-pet/datastruct/projection/Histogram3D.hpp"
 #include "petsird/protocols.h"
 
+#include <memory>
+
 namespace yrt::petsird
 {
+	class ScannerContext;
+
 	class PETSIRDNorm final : public Histogram3D
 	{
 	public:
-		PETSIRDNorm(const Scanner& pr_scanner,
-		            const ::petsird::ScannerInformation& pr_scannerInfo,
-		            const DetectorCorrespondenceMap& pr_correspondence);
+		// The normalisation shares the ownership of the scanner context
+		explicit PETSIRDNorm(
+		    std::shared_ptr<const ScannerContext> pp_scannerContext);
 
 		float getProjectionValue(bin_t binId) const override;
 
@@ -22,7 +25,6 @@ namespace yrt::petsird
 
 
 	private:
-		const DetectorCorrespondenceMap mr_correspondence;
-		const ::petsird::ScannerInformation& mr_scannerInfo;
+		std::shared_ptr<const ScannerContext> mp_scannerContext;
 	};
 }  // namespace yrt::petsird
@@ -0,0 +1,154 @@
+#include "Profiler.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace yrt::petsird
+{
+	Profiler::Profiler()
+	    : m_wallStart(std::chrono::steady_clock::now()),
+	      m_cpuStart_s(getProcessCPUTime_s()),
+	      m_stageCPUStart_s(0.0),
+	      m_stagePeakRSSStart_bytes(0)
+	{
+	}
+
+	void Profiler::beginStage(const std::string& name)
+	{
+		if (isInStage())
+		{
+			endStage();
+		}
+		m_currentStageName = name;
+		m_stageWallStart = std::chrono::steady_clock::now();
+		m_stageCPUStart_s = getProcessCPUTime_s();
+		m_stagePeakRSSStart_bytes = getPeakRSS_bytes();
+	}
+
+	void Profiler::endStage(uint64_t numItems, const std::string& itemUnit)
+	{
+		if (!isInStage())
+		{
+			throw std::logic_error("No profiling stage to end");
+		}
+		StageProfile stage;
+		stage.name = m_currentStageName;
+		stage.wallTime_s = std::chrono::duration<double>(
+		                       std::chrono::steady_clock::now() -
+		                       m_stageWallStart)
+		                       .count();
+		stage.cpuTime_s = getProcessCPUTime_s() - m_stageCPUStart_s;
+		stage.processPeakRSS_bytes = getPeakRSS_bytes();
+		stage.peakRSSIncrease_bytes =
+		    stage.processPeakRSS_bytes - m_stagePeakRSSStart_bytes;
+		stage.numItems = numItems;
+		stage.itemUnit = itemUnit;
+		m_stages.push_back(stage);
+		m_currentStageName.clear();
+	}
+
+	bool Profiler::isInStage() const
+	{
+		return !m_currentStageName.empty();
+	}
+
+	const std::vector<StageProfile>& Profiler::getStages() const
+	{
+		return m_stages;
+	}
+
+	void Profiler::setContext(const std::string& key, const std::string& value)
+	{
+		m_context.emplace_back(key, value);
+	}
+
+	void Profiler::writeJSON(const std::string& fname) const
+	{
+		nlohmann::json stages = nlohmann::json::array();
+		for (const auto& stage : m_stages)
+		{
+			nlohmann::json stageJSON{
+			    {"name", stage.name},
+			    {"wall_time_s", stage.wallTime_s},
+			    {"cpu_time_s", stage.cpuTime_s},
+			    {"process_peak_rss_bytes", stage.processPeakRSS_bytes},
+			    {"peak_rss_increase_bytes", stage.peakRSSIncrease_bytes}};
+			if (stage.numItems > 0)
+			{
+				stageJSON["num_items"] = stage.numItems;
+				stageJSON["item_unit"] = stage.itemUnit;
+				if (stage.wallTime_s > 0.0)
+				{
+					stageJSON["items_per_s"] =
+					    static_cast<double>(stage.numItems) / stage.wallTime_s;
+				}
+			}
+			stages.push_back(stageJSON);
+		}
+
+		nlohmann::json context = nlohmann::json::object();
+		for (const auto& [key, value] : m_context)
+		{
+			context[key] = value;
+		}
+
+		const nlohmann::json report{
+		    {"context", context},
+		    {"stages", stages},
+		    {"total",
+		     {{"wall_time_s", std::chrono::duration<double>(
+		                          std::chrono::steady_clock::now() -
+		                          m_wallStart)
+		                          .count()},
+		      {"cpu_time_s", getProcessCPUTime_s() - m_cpuStart_s},
+		      {"process_peak_rss_bytes", getPeakRSS_bytes()}}}};
+
+		std::ofstream file{fname};
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Could not open " + fname);
+		}
+		file << report.dump(4) << std::endl;
+	}
+
+	double Profiler::getProcessCPUTime_s()
+	{
+#if defined(__unix__) || defined(__APPLE__)
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		const auto toSeconds = [](const timeval& tv)
+		{
+			return static_cast<double>(tv.tv_sec) +
+			       static_cast<double>(tv.tv_usec) * 1e-6;
+		};
+		return toSeconds(usage.ru_utime) + toSeconds(usage.ru_stime);
+#else
+		// Not measured on this platform
+		return 0.0;
+#endif
+	}
+
+	uint64_t Profiler::getPeakRSS_bytes()
+	{
+#if defined(__unix__) || defined(__APPLE__)
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+		// ru_maxrss is in bytes on macOS
+		return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+		// ru_maxrss is in kilobytes on Linux
+		return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+		// Not measured on this platform
+		return 0;
+#endif
+	}
+}  // namespace yrt::petsird
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace yrt::petsird
+{
+	// Resources used by one stage of the pipeline
+	struct StageProfile
+	{
+		std::string name;
+		double wallTime_s = 0.0;
+		// User and system time of all the threads of the process
+		double cpuTime_s = 0.0;
+		// High-water mark of the resident memory of the process (since its
+		//  start, not only during the stage) at the end of the stage
+		uint64_t processPeakRSS_bytes = 0;
+		// Increase of that high-water mark during the stage. Zero when the
+		//  stage stays below the peak of an earlier stage
+		uint64_t peakRSSIncrease_bytes = 0;
+		// Number of items processed (events, bins, ...), zero if not
+		//  applicable
+		uint64_t numItems = 0;
+		std::string itemUnit;
+	};
+
+	// Records the wall time, CPU time, memory and throughput of each
+	//  stage of the pipeline and writes them as a JSON report
+	class Profiler
+	{
+	public:
+		Profiler();
+
+		// Starts measuring a stage. Stages are sequential: Beginning a stage
+		//  ends the current one
+		void beginStage(const std::string& name);
+		// Ends the current stage, with the number of items it processed
+		//  (used for the throughput)
+		void endStage(uint64_t numItems = 0, const std::string& itemUnit = "");
+		bool isInStage() const;
+
+		const std::vector<StageProfile>& getStages() const;
+
+		// Adds a key-value pair to the "context" section of the report
+		void setContext(const std::string& key, const std::string& value);
+
+		// Writes the report (stages and totals) as JSON
+		void writeJSON(const std::string& fname) const;
+
+		// CPU time (user and system) used by the process so far. Zero on
+		//  the platforms without getrusage
+		static double getProcessCPUTime_s();
+		// High-water mark of the resident memory of the process. Zero on
+		//  the platforms without getrusage
+		static uint64_t getPeakRSS_bytes();
+
+	private:
+		std::vector<StageProfile> m_stages;
+		std::vector<std::pair<std::string, std::string>> m_context;
+		std::chrono::steady_clock::time_point m_wallStart;
+		double m_cpuStart_s;
+
+		std::string m_currentStageName;
+		std::chrono::steady_clock::time_point m_stageWallStart;
+		double m_stageCPUStart_s;
+		uint64_t m_stagePeakRSSStart_bytes;
+	};
+}  // namespace yrt::petsird
@@ -0,0 +1,213 @@
+#include "ProgressReporter.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+namespace yrt::petsird
+{
+	namespace
+	{
+		std::string formatBytes(uint64_t numBytes)
+		{
+			const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+			double value = static_cast<double>(numBytes);
+			size_t unit_i = 0;
+			while (value >= 1024.0 && unit_i < 4)
+			{
+				value /= 1024.0;
+				unit_i++;
+			}
+			std::ostringstream oss;
+			oss << std::fixed << std::setprecision(1) << value << " "
+			    << units[unit_i];
+			return oss.str();
+		}
+
+		std::string formatDuration(double seconds)
+		{
+			const uint64_t totalSeconds = static_cast<uint64_t>(seconds);
+			std::ostringstream oss;
+			oss << totalSeconds / 3600 << "h" << std::setfill('0')
+			    << std::setw(2) << (totalSeconds / 60) % 60 << "m"
+			    << std::setw(2) << totalSeconds % 60 << "s";
+			return oss.str();
+		}
+	}  // namespace
+
+	ProgressReporter::ProgressReporter(std::ostream& pr_out,
+	                                   std::chrono::milliseconds interval,
+	                                   int numThreads)
+	    : mr_out(pr_out),
+	      m_interval(interval),
+	      m_threadCounters(std::max(numThreads, 1)),
+	      m_totalTimeBlocks(0),
+	      m_totalBytes(0),
+	      m_bytesReadAtStart(0),
+	      m_stopRequested(false)
+	{
+		if (m_interval.count() > 0)
+		{
+			m_monitorThread = std::thread{&ProgressReporter::monitorLoop, this};
+		}
+	}
+
+	ProgressReporter::~ProgressReporter()
+	{
+		{
+			std::lock_guard lock{m_mutex};
+			m_stopRequested = true;
+		}
+		m_wakeUp.notify_all();
+		if (m_monitorThread.joinable())
+		{
+			m_monitorThread.join();
+		}
+	}
+
+	void ProgressReporter::beginPhase(const std::string& name,
+	                                  uint64_t totalTimeBlocks,
+	                                  uint64_t totalBytes)
+	{
+		std::lock_guard lock{m_mutex};
+		for (auto& counters : m_threadCounters)
+		{
+			counters.numTimeBlocks.store(0, std::memory_order_relaxed);
+			counters.numEvents.store(0, std::memory_order_relaxed);
+		}
+		m_phaseName = name;
+		m_totalTimeBlocks = totalTimeBlocks;
+		m_totalBytes = totalBytes;
+		m_bytesReadAtStart = getProcessBytesRead();
+		m_phaseStart = std::chrono::steady_clock::now();
+	}
+
+	void ProgressReporter::endPhase()
+	{
+		std::lock_guard lock{m_mutex};
+		if (m_interval.count() > 0 && !m_phaseName.empty())
+		{
+			printStatus(true);
+		}
+		m_phaseName.clear();
+	}
+
+	void ProgressReporter::addProgress(int thread_i, uint64_t numTimeBlocks,
+	                                   uint64_t numEvents)
+	{
+		ThreadCounters& counters =
+		    m_threadCounters[thread_i % m_threadCounters.size()];
+		counters.numTimeBlocks.fetch_add(numTimeBlocks,
+		                                 std::memory_order_relaxed);
+		counters.numEvents.fetch_add(numEvents, std::memory_order_relaxed);
+	}
+
+	uint64_t ProgressReporter::getProcessBytesRead()
+	{
+		// "rchar" counts the bytes read through read(2), including those
+		//  served from the page cache
+		std::ifstream io{"/proc/self/io"};
+		std::string key;
+		uint64_t value;
+		while (io >> key >> value)
+		{
+			if (key == "rchar:")
+			{
+				return value;
+			}
+		}
+		return 0;
+	}
+
+	void ProgressReporter::monitorLoop()
+	{
+		std::unique_lock lock{m_mutex};
+		while (!m_stopRequested)
+		{
+			m_wakeUp.wait_for(lock, m_interval);
+			if (!m_stopRequested && !m_phaseName.empty())
+			{
+				printStatus(false);
+			}
+		}
+	}
+
+	void ProgressReporter::printStatus(bool isFinal)
+	{
+		uint64_t numTimeBlocks = 0;
+		uint64_t numEvents = 0;
+		for (const auto& counters : m_threadCounters)
+		{
+			numTimeBlocks +=
+			    counters.numTimeBlocks.load(std::memory_order_relaxed);
+			numEvents += counters.numEvents.load(std::memory_order_relaxed);
+		}
+		const uint64_t processBytesRead = getProcessBytesRead();
+		const uint64_t bytesRead =
+		    processBytesRead > m_bytesReadAtStart
+		        ? processBytesRead - m_bytesReadAtStart
+		        : 0;
+		const double elapsed_s = std::chrono::duration<double>(
+		                             std::chrono::steady_clock::now() -
+		                             m_phaseStart)
+		                             .count();
+
+		std::ostringstream oss;
+		oss << "[" << m_phaseName << "] " << formatDuration(elapsed_s);
+		// Only reported for the phases that read a known amount of data
+		//  (Reading /proc/self/io is itself counted in rchar)
+		if (m_totalBytes > 0)
+		{
+			const double bytesPerSecond =
+			    bytesRead / std::max(elapsed_s, 1e-3);
+			oss << ", " << formatBytes(bytesRead) << " / "
+			    << formatBytes(m_totalBytes) << " ("
+			    << formatBytes(static_cast<uint64_t>(bytesPerSecond))
+			    << "/s)";
+		}
+		if (numTimeBlocks > 0 || m_totalTimeBlocks > 0)
+		{
+			oss << ", " << numTimeBlocks;
+			if (m_totalTimeBlocks > 0)
+			{
+				oss << " / " << m_totalTimeBlocks;
+			}
+			oss << " time blocks";
+		}
+		if (numEvents > 0)
+		{
+			oss << ", " << std::fixed << std::setprecision(2)
+			    << numEvents / std::max(elapsed_s, 1e-3) * 1e-6
+			    << " M events/s";
+		}
+
+		// Fraction done, from the bytes if the total is known, from the time
+		//  blocks otherwise
+		double fractionDone = -1.0;
+		if (m_totalBytes > 0)
+		{
+			fractionDone = static_cast<double>(bytesRead) / m_totalBytes;
+		}
+		else if (m_totalTimeBlocks > 0)
+		{
+			fractionDone =
+			    static_cast<double>(numTimeBlocks) / m_totalTimeBlocks;
+		}
+		if (isFinal)
+		{
+			oss << ", done";
+		}
+		else if (fractionDone > 0.0)
+		{
+			fractionDone = std::min(fractionDone, 1.0);
+			oss << ", " << std::fixed << std::setprecision(1)
+			    << 100.0 * fractionDone << "%, ETA "
+			    << formatDuration(elapsed_s * (1.0 - fractionDone) /
+			                      fractionDone);
+		}
+
+		mr_out << oss.str() << std::endl;
+	}
+}  // namespace yrt::petsird
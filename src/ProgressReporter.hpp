@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace yrt::petsird
+{
+	// Periodically prints the progress of a long phase (bytes read, time
+	//  blocks decoded, events/s and ETA) from a monitor thread. Worker
+	//  threads only increment their own counters, which the monitor thread
+	//  aggregates at each update
+	class ProgressReporter
+	{
+	public:
+		// An interval of zero disables the reporting (The counters are
+		//  still accepted)
+		ProgressReporter(std::ostream& pr_out,
+		                 std::chrono::milliseconds interval, int numThreads);
+		~ProgressReporter();
+
+		ProgressReporter(const ProgressReporter&) = delete;
+		ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+		// Starts a phase and resets the counters. The totals (zero if
+		//  unknown) are used for the percentage and the ETA
+		void beginPhase(const std::string& name, uint64_t totalTimeBlocks,
+		                uint64_t totalBytes);
+		// Prints the final state of the current phase
+		void endPhase();
+
+		// Called by the worker threads (thread_i is the OpenMP thread index)
+		void addProgress(int thread_i, uint64_t numTimeBlocks,
+		                 uint64_t numEvents);
+
+		// Bytes read by the process so far (From /proc/self/io, zero if it
+		//  is not available)
+		static uint64_t getProcessBytesRead();
+
+	private:
+		// Padded to a cache line so that threads do not share counters
+		struct alignas(64) ThreadCounters
+		{
+			std::atomic<uint64_t> numTimeBlocks{0};
+			std::atomic<uint64_t> numEvents{0};
+		};
+
+		void monitorLoop();
+		void printStatus(bool isFinal);
+
+		std::ostream& mr_out;
+		const std::chrono::milliseconds m_interval;
+		std::vector<ThreadCounters> m_threadCounters;
+
+		// Current phase (protected by m_mutex)
+		std::string m_phaseName;
+		uint64_t m_totalTimeBlocks;
+		uint64_t m_totalBytes;
+		uint64_t m_bytesReadAtStart;
+		std::chrono::steady_clock::time_point m_phaseStart;
+
+		std::mutex m_mutex;
+		std::condition_variable m_wakeUp;
+		bool m_stopRequested;
+		std::thread m_monitorThread;
+	};
+}  // namespace yrt::petsird
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace yrt::petsird
+{
+	// Stable, parallel LSD radix sort of a list of indices, using 16-bit
+	//  digits. `getKey(index)` returns the 64-bit key of an index and
+	//  `numKeyBits` is the number of significant bits of the keys
+	template <typename Index, typename KeyFunc>
+	void radixSortIndices(std::vector<Index>& indices, KeyFunc getKey,
+	                      int numKeyBits)
+	{
+		constexpr int DigitBits = 16;
+		constexpr size_t NumBuckets = size_t{1} << DigitBits;
+		constexpr uint64_t DigitMask = NumBuckets - 1;
+
+		const size_t numIndices = indices.size();
+		std::vector<Index> sorted(numIndices);
+
+		const int numThreads = std::max(globals::getNumThreads(), 1);
+		std::vector<size_t> offsets(NumBuckets * numThreads);
+
+		for (int shift = 0; shift < numKeyBits; shift += DigitBits)
+		{
+			std::fill(offsets.begin(), offsets.end(), 0);
+
+#pragma omp parallel num_threads(numThreads)
+			{
+#if defined(_OPENMP)
+				const int thread_i = omp_get_thread_num();
+				const int numActiveThreads = omp_get_num_threads();
+#else
+				const int thread_i = 0;
+				const int numActiveThreads = 1;
+#endif
+				const size_t chunkBegin =
+				    numIndices * thread_i / numActiveThreads;
+				const size_t chunkEnd =
+				    numIndices * (thread_i + 1) / numActiveThreads;
+				size_t* threadCounts = &offsets[thread_i * NumBuckets];
+
+				for (size_t i = chunkBegin; i < chunkEnd; i++)
+				{
+					threadCounts[(getKey(indices[i]) >> shift) & DigitMask]++;
+				}
+
+#pragma omp barrier
+#pragma omp single
+				{
+					// Exclusive prefix sum in (bucket, thread) order so that
+					//  the sort stays stable
+					size_t total = 0;
+					for (size_t bucket = 0; bucket < NumBuckets; bucket++)
+					{
+						for (int t = 0; t < numActiveThreads; t++)
+						{
+							size_t& count = offsets[t * NumBuckets + bucket];
+							const size_t bucketCount = count;
+							count = total;
+							total += bucketCount;
+						}
+					}
+				}
+
+				for (size_t i = chunkBegin; i < chunkEnd; i++)
+				{
+					const Index index = indices[i];
+					sorted[threadCounts[(getKey(index) >> shift) &
+					                    DigitMask]++] = index;
+				}
+			}
+
+			indices.swap(sorted);
+		}
+	}
+}  // namespace yrt::petsird
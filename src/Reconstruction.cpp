@@ -0,0 +1,660 @@
+#include "Reconstruction.hpp"
+
+#include "ListModeLUTWriter.hpp"
+#include "PETSIRDFile.hpp"
+#include "Profiler.hpp"
+#include "ProgressReporter.hpp"
+#include "SensitivityCache.hpp"
+#include "TimeBlockPool.hpp"
+#include "Tracer.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+#include "yrt-pet/utils/ReconstructionUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+namespace yrt::petsird
+{
+	namespace
+	{
+		// Reads the key into the value if it is present
+		template <typename T>
+		void readJobValue(const nlohmann::json& job, const char* key, T& value)
+		{
+			const auto it = job.find(key);
+			if (it != job.end())
+			{
+				it->get_to(value);
+			}
+		}
+
+		// Sensitivity images from, in order: The given file, the in-memory
+		//  cache, the on-disk cache, or a new generation
+		std::shared_ptr<const SensitivityImages> getSensitivityImages(
+		    OSEM& osem, const ScannerContext& scannerContext,
+		    const ReconstructionOptions& options, bool useHistogram,
+		    ReconstructionCaches* pp_caches, Profiler& pr_profiler,
+		    ProgressReporter& pr_progress)
+		{
+			auto sensImages = std::make_shared<SensitivityImages>();
+			if (!options.sensImage_fname.empty())
+			{
+				pr_profiler.setContext("sensitivity_source", "file");
+				sensImages->push_back(
+				    std::make_unique<ImageOwned>(options.sensImage_fname));
+				return sensImages;
+			}
+
+			const bool useDiskCache = !options.sensCacheDir.empty();
+			std::string sensCacheKey;
+			if (useDiskCache || pp_caches != nullptr)
+			{
+				sensCacheKey = SensitivityCache::computeKey(
+				    {scannerContext.getHash(), options.imageParams_fname,
+				     options.psfKernel_fname, options.attImage_fname,
+				     options.useNorm, options.useTOF, !useHistogram,
+				     options.numSubsets,
+				     getPreviewDownsampling(options.previewFraction)});
+			}
+
+			// Concurrent reconstructions that need the same images wait for
+			//  the first one to generate them
+			std::unique_lock<std::mutex> sensitivityLock;
+			if (pp_caches != nullptr)
+			{
+				sensitivityLock = std::unique_lock<std::mutex>{
+				    pp_caches->getSensitivityMutex()};
+				auto cachedImages =
+				    pp_caches->getSensitivityImages(sensCacheKey);
+				if (cachedImages != nullptr)
+				{
+					pr_profiler.setContext("sensitivity_source", "memory");
+					if (!options.outSensImage_fname.empty())
+					{
+						writeSensitivityImages(*cachedImages,
+						                       options.outSensImage_fname);
+					}
+					return cachedImages;
+				}
+			}
+
+			std::unique_ptr<SensitivityCache> sensCache;
+			bool loadedFromCache = false;
+			if (useDiskCache)
+			{
+				sensCache =
+				    std::make_unique<SensitivityCache>(options.sensCacheDir);
+				loadedFromCache =
+				    sensCache->load(sensCacheKey,
+				                    osem.getExpectedSensImagesAmount(),
+				                    *sensImages);
+			}
+
+			pr_profiler.setContext("sensitivity_source",
+			                       loadedFromCache ? "cache" : "generated");
+			if (loadedFromCache)
+			{
+				std::cout << "Using cached sensitivity images: "
+				          << sensCache->getCacheDirectory() << "/"
+				          << sensCacheKey << std::endl;
+				if (!options.outSensImage_fname.empty())
+				{
+					writeSensitivityImages(*sensImages,
+					                       options.outSensImage_fname);
+				}
+			}
+			else
+			{
+				// Includes the evaluation of the normalisation factors, whose
+				//  loop is run by YRT-PET
+				const TraceSpan span{options.useNorm ?
+				                         "sensitivity images (with norm)" :
+				                         "sensitivity images"};
+				// Only the elapsed time can be reported, the generation is
+				//  done by YRT-PET
+				pr_progress.beginPhase("sensitivity", 0, 0);
+				osem.generateSensitivityImages(*sensImages,
+				                               options.outSensImage_fname);
+				pr_progress.endPhase();
+				if (sensCache != nullptr)
+				{
+					sensCache->store(sensCacheKey, *sensImages);
+				}
+			}
+
+			if (pp_caches != nullptr)
+			{
+				pp_caches->storeSensitivityImages(sensCacheKey, sensImages);
+			}
+			return sensImages;
+		}
+	}  // namespace
+
+	DataMode parseDataMode(const std::string& dataMode_str)
+	{
+		if (dataMode_str == "auto")
+		{
+			return DataMode::Auto;
+		}
+		if (dataMode_str == "listmode")
+		{
+			return DataMode::ListMode;
+		}
+		if (dataMode_str == "histogram")
+		{
+			return DataMode::Histogram;
+		}
+		throw std::invalid_argument("Unknown reconstruction mode: " +
+		                            dataMode_str);
+	}
+
+	void applyReconstructionJob(const nlohmann::json& job,
+	                            ReconstructionOptions& options)
+	{
+		readJobValue(job, "input", options.input_fname);
+		readJobValue(job, "params", options.imageParams_fname);
+		readJobValue(job, "out", options.outImage_fname);
+		readJobValue(job, "psf", options.psfKernel_fname);
+		readJobValue(job, "att", options.attImage_fname);
+		readJobValue(job, "sens", options.sensImage_fname);
+		readJobValue(job, "out_sens", options.outSensImage_fname);
+		readJobValue(job, "out_scanner_lut", options.outScannerLUT_fname);
+		readJobValue(job, "out_listmode", options.outListMode_fname);
+		readJobValue(job, "sens_cache_dir", options.sensCacheDir);
+		readJobValue(job, "scratch_dir", options.scratchDir);
+		readJobValue(job, "huge_pages", options.useHugePages);
+		readJobValue(job, "numa_first_touch", options.numaFirstTouch);
+		readJobValue(job, "tof", options.useTOF);
+		readJobValue(job, "gpu", options.useGPU);
+		readJobValue(job, "norm", options.useNorm);
+		readJobValue(job, "coalesce", options.coalesceEvents);
+		readJobValue(job, "coalesce_frame_duration", options.frameDuration_ms);
+		readJobValue(job, "chronological_subsets",
+		             options.chronologicalSubsets);
+		readJobValue(job, "sort_lors", options.sortLORs);
+		readJobValue(job, "num_gates", options.gating.numGates);
+		readJobValue(job, "gate_signal_id", options.gating.signalId);
+		readJobValue(job, "motion_correction", options.motionCorrection);
+		readJobValue(job, "cull_fov", options.cullFOV);
+		readJobValue(job, "histogram_threshold", options.histogramThreshold);
+		readJobValue(job, "num_subsets", options.numSubsets);
+		readJobValue(job, "num_iterations", options.numIterations);
+		readJobValue(job, "preview_fraction", options.previewFraction);
+
+		const auto mode = job.find("mode");
+		if (mode != job.end())
+		{
+			options.dataMode = parseDataMode(mode->get<std::string>());
+		}
+		const auto gatingMode = job.find("gating_mode");
+		if (gatingMode != job.end())
+		{
+			options.gating.mode =
+			    parseGatingMode(gatingMode->get<std::string>());
+		}
+	}
+
+	ReconstructionOptions
+	    parseReconstructionJob(const nlohmann::json& job,
+	                           const ReconstructionOptions& defaults)
+	{
+		ReconstructionOptions options = defaults;
+		applyReconstructionJob(job, options);
+
+		if (options.input_fname.empty() || options.imageParams_fname.empty() ||
+		    options.outImage_fname.empty())
+		{
+			throw std::invalid_argument(
+			    "A job requires \"input\", \"params\" and \"out\"");
+		}
+		return options;
+	}
+
+	PreparedAcquisition prepareAcquisition(const ReconstructionOptions& options,
+	                                       ReconstructionCaches* pp_caches,
+	                                       Profiler& pr_profiler,
+	                                       ProgressReporter& pr_progress)
+	{
+		const bool useGating = options.gating.numGates > 0;
+		if (useGating &&
+		    (options.coalesceEvents || options.sortLORs ||
+		     options.dataMode == DataMode::Histogram))
+		{
+			throw std::invalid_argument(
+			    "Gating cannot be combined with the coalescing, the LOR "
+			    "sorting or the histogram mode");
+		}
+
+		// The coalescing and the LOR sorting only apply to list-mode
+		if (options.dataMode == DataMode::Histogram &&
+		    (options.coalesceEvents || options.sortLORs))
+		{
+			throw std::invalid_argument(
+			    "The histogram mode cannot be combined with the coalescing "
+			    "or the LOR sorting");
+		}
+
+		PreparedAcquisition acquisition;
+
+		// Read PETSIRD FILE and its header
+		pr_profiler.beginStage("read_header");
+		PETSIRDFile petsirdFile{options.input_fname};
+		pr_profiler.endStage();
+
+		// Convert the scanner
+		pr_profiler.beginStage("to_scanner");
+		if (pp_caches != nullptr)
+		{
+			acquisition.scannerContext =
+			    pp_caches->getScannerContext(petsirdFile.getHeader().scanner);
+		}
+		else
+		{
+			acquisition.scannerContext = std::make_shared<const ScannerContext>(
+			    petsirdFile.getHeader().scanner);
+		}
+		const ScannerContext& scannerContext = *acquisition.scannerContext;
+		const Scanner& scanner = scannerContext.getScanner();
+		pr_profiler.endStage(scanner.getNumDets(), "detectors");
+
+		if (!options.outScannerLUT_fname.empty())
+		{
+			std::cout << "Output scanner LUT file: "
+			          << options.outScannerLUT_fname << std::endl;
+			auto detSetup = scanner.getDetectorSetup();
+			detSetup->writeToFile(options.outScannerLUT_fname);
+		}
+
+		// TODO: Save the scanner's JSON file
+
+		// Each batch of time blocks is decoded as soon as it is read, in
+		//  reused batch containers
+		TimeBlockPool localTimeBlockPool;
+		TimeBlockPool& timeBlockPool = pp_caches != nullptr ?
+		                                   pp_caches->getTimeBlockPool() :
+		                                   localTimeBlockPool;
+		pr_profiler.beginStage("ingest");
+		pr_progress.beginPhase("ingest", 0,
+		                       std::filesystem::file_size(options.input_fname));
+		EventStorageOptions eventStorage;
+		eventStorage.scratchDir = options.scratchDir;
+		eventStorage.useHugePages = options.useHugePages;
+		auto lm = scannerContext.createListMode({}, options.useTOF,
+		                                        eventStorage);
+		if (options.previewFraction < 1.0f)
+		{
+			lm->setEventSubsampling(options.previewFraction);
+		}
+		// The list-mode export is written during the ingest, before the
+		//  events are culled, coalesced or reordered
+		std::unique_ptr<ListModeLUTWriter> listModeWriter;
+		if (!options.outListMode_fname.empty())
+		{
+			std::cout << "Output list-mode file: " << options.outListMode_fname
+			          << std::endl;
+			listModeWriter = std::make_unique<ListModeLUTWriter>(
+			    options.outListMode_fname, options.useTOF);
+		}
+		const size_t numTimeBlocks =
+		    lm->readTimeBlocks(petsirdFile, timeBlockPool, &pr_progress,
+		                       listModeWriter.get());
+		pr_progress.endPhase();
+		if (numTimeBlocks == 0)
+		{
+			throw std::runtime_error("Error while reading time blocks");
+		}
+		pr_profiler.endStage(lm->count(), "events");
+		if (lm->count() < lm->getNumStreamEvents())
+		{
+			std::cout << "Preview: Kept " << lm->count() << " of "
+			          << lm->getNumStreamEvents() << " events" << std::endl;
+			// The actual ratio, which is about 1 / round(1 / fraction)
+			acquisition.keptEventFraction =
+			    static_cast<double>(lm->count()) /
+			    static_cast<double>(lm->getNumStreamEvents());
+		}
+		if (listModeWriter != nullptr)
+		{
+			listModeWriter->close();
+			std::cout << "Wrote " << listModeWriter->getNumEventsWritten()
+			          << " events to " << options.outListMode_fname
+			          << std::endl;
+		}
+		lm->setMotionCorrection(options.motionCorrection);
+
+		if (options.cullFOV)
+		{
+			const size_t numEventsBefore = lm->count();
+			pr_profiler.beginStage("cull_fov");
+			lm->cullEventsOutsideFOV(ImageParams{options.imageParams_fname});
+			pr_profiler.endStage(numEventsBefore, "events");
+			std::cout << "Dropped " << numEventsBefore - lm->count()
+			          << " events whose LOR misses the image" << std::endl;
+		}
+
+		// Choose between list-mode and histogram-mode reconstruction
+		if (lm->hasMotion())
+		{
+			std::cout << "Bed and gantry movements give "
+			          << lm->getNumFrames() << " motion states" << std::endl;
+			if (options.dataMode == DataMode::Histogram)
+			{
+				throw std::invalid_argument(
+				    "The histogram mode cannot correct the motion");
+			}
+		}
+		// The automatic mode keeps list-mode when a list-mode option is
+		//  given. The histogram is only built if it may be used
+		const bool needsListMode = useGating || lm->hasMotion() ||
+		                           options.coalesceEvents || options.sortLORs;
+		std::unique_ptr<Histogram3DOwned> histo;
+		if (options.dataMode == DataMode::Histogram ||
+		    (options.dataMode == DataMode::Auto && !options.useTOF &&
+		     !needsListMode))
+		{
+			histo = std::make_unique<Histogram3DOwned>(scanner);
+		}
+		const bool useHistogram =
+		    histo != nullptr &&
+		    shouldUseHistogramMode(options.dataMode, lm->count(),
+		                           histo->count(), options.useTOF,
+		                           options.histogramThreshold);
+		pr_profiler.setContext("mode", useHistogram ? "histogram" : "listmode");
+
+		if (useHistogram)
+		{
+			std::cout << "Binning " << lm->count()
+			          << " events into a histogram of " << histo->count()
+			          << " bins" << std::endl;
+			pr_profiler.beginStage("histogram_binning");
+			histo->allocate();
+			binListModeToHistogram(*lm, *histo);
+			pr_profiler.endStage(lm->count(), "events");
+			acquisition.histogram = std::move(histo);
+			return acquisition;
+		}
+
+		if (options.coalesceEvents)
+		{
+			const size_t numEventsBefore = lm->count();
+			pr_profiler.beginStage("coalesce_events");
+			lm->coalesceDuplicateEvents(
+			    static_cast<timestamp_t>(options.frameDuration_ms));
+			pr_profiler.endStage(numEventsBefore, "events");
+			std::cout << "Coalesced " << numEventsBefore << " events into "
+			          << lm->count() << " weighted events" << std::endl;
+		}
+
+		if (useGating)
+		{
+			// The events are stored gate by gate, each gate is then
+			//  reconstructed through a view over its range
+			pr_profiler.beginStage("gating");
+			const size_t numEventsBefore = lm->count();
+			lm->applyGating(options.gating);
+			pr_profiler.endStage(numEventsBefore, "events");
+			for (size_t gate = 0; gate < lm->getNumGates(); gate++)
+			{
+				const auto [begin, end] = lm->getGateRange(gate);
+				std::cout << "Gate " << gate << ": " << end - begin
+				          << " events" << std::endl;
+				acquisition.gates.push_back(
+				    std::make_unique<PETSIRDListModeView>(*lm, begin, end));
+			}
+			std::cout << numEventsBefore - lm->count()
+			          << " events are outside of the gated range" << std::endl;
+
+			// Each subset of a gate needs an event. Checked before any gate
+			//  is reconstructed
+			const size_t numSubsets =
+			    static_cast<size_t>(std::max(options.numSubsets, 1));
+			for (size_t gate = 0; gate < acquisition.gates.size(); gate++)
+			{
+				if (acquisition.gates[gate]->count() < numSubsets)
+				{
+					throw std::runtime_error(
+					    "Gate " + std::to_string(gate) + " has " +
+					    std::to_string(acquisition.gates[gate]->count()) +
+					    " events, fewer than the " +
+					    std::to_string(numSubsets) +
+					    " subsets (Use fewer gates or subsets)");
+				}
+			}
+		}
+		else if (options.numSubsets > 1 && !options.chronologicalSubsets)
+		{
+			pr_profiler.beginStage("partition_subsets");
+			lm->partitionSubsets(options.numSubsets);
+			pr_profiler.endStage(lm->count(), "events");
+		}
+
+		if (options.sortLORs)
+		{
+			pr_profiler.beginStage("sort_lors");
+			lm->sortEventsByLORLocality(options.numSubsets);
+			pr_profiler.endStage(lm->count(), "events");
+		}
+
+		if (lm->hasMotion())
+		{
+			pr_profiler.beginStage("group_motion_states");
+			lm->groupEventsByMotionState(options.numSubsets);
+			pr_profiler.endStage(lm->count(), "events");
+		}
+
+		if (options.numaFirstTouch)
+		{
+			pr_profiler.beginStage("numa_first_touch");
+			lm->placeEventsForReconstruction(options.numSubsets);
+			pr_profiler.endStage(lm->count(), "events");
+		}
+
+		acquisition.listMode = std::move(lm);
+		return acquisition;
+	}
+
+	std::vector<std::unique_ptr<ImageOwned>>
+	    reconstructAcquisition(const PreparedAcquisition& acquisition,
+	                           const ReconstructionOptions& options,
+	                           ReconstructionCaches* pp_caches,
+	                           Profiler& pr_profiler,
+	                           ProgressReporter& pr_progress)
+	{
+		const ScannerContext& scannerContext = *acquisition.scannerContext;
+		const bool useHistogram = acquisition.histogram != nullptr;
+
+		// Initialize reconstruction
+		auto osem =
+		    util::createOSEM(scannerContext.getScanner(), options.useGPU);
+		osem->setListModeEnabled(!useHistogram);
+		// The number of subsets determines the number of sensitivity images
+		//  in histogram-mode
+		osem->num_MLEM_iterations = options.numIterations;
+		osem->num_OSEM_subsets = options.numSubsets;
+
+		// Read image parameters
+		const int downsampling =
+		    getPreviewDownsampling(options.previewFraction);
+		ImageParams params = getDownsampledImageParams(
+		    ImageParams{options.imageParams_fname}, downsampling);
+		osem->setImageParams(params);
+		if (downsampling > 1)
+		{
+			std::cout << "Preview image grid: " << params.nx << "x"
+			          << params.ny << "x" << params.nz << std::endl;
+		}
+
+		// The PSF kernel is meant for the full-resolution grid
+		if (!options.psfKernel_fname.empty() && downsampling == 1)
+		{
+			osem->addImagePSF(options.psfKernel_fname);
+		}
+
+		std::shared_ptr<const PETSIRDNorm> norm;
+		if (options.useNorm)
+		{
+			if (pp_caches != nullptr)
+			{
+				norm = pp_caches->getNorm(acquisition.scannerContext);
+			}
+			else
+			{
+				norm = scannerContext.createNorm();
+			}
+			osem->setSensitivityHistogram(norm.get());
+		}
+
+		std::unique_ptr<Image> attImage;
+		if (!options.attImage_fname.empty())
+		{
+			attImage = std::make_unique<ImageOwned>(options.attImage_fname);
+			osem->setAttenuationImage(attImage.get());
+		}
+
+		// The sensitivity images are those of the static scanner: Under
+		//  motion, the events are corrected but not the sensitivity, whose
+		//  cache key thus ignores the motion states
+		if (acquisition.listMode != nullptr &&
+		    acquisition.listMode->hasMotion())
+		{
+			std::cout << "Warning: The sensitivity images are not corrected "
+			             "for the motion"
+			          << std::endl;
+		}
+		pr_profiler.beginStage("sensitivity_images");
+		const auto sensImages =
+		    getSensitivityImages(*osem, scannerContext, options, useHistogram,
+		                         pp_caches, pr_profiler, pr_progress);
+		pr_profiler.endStage(sensImages->size(), "images");
+
+		osem->setSensitivityImages(*sensImages);
+
+		if (options.useTOF)
+		{
+			float tofResolution_ps =
+			    scannerContext.getScannerInformation().tof_resolution[0][0] *
+			    2.0f / SPEED_OF_LIGHT_MM_PS;
+			osem->addTOF(tofResolution_ps, 5);
+		}
+
+		// Number of events (or bins) processed by all the iterations
+		const uint64_t numReconItems =
+		    static_cast<uint64_t>(useHistogram
+		                              ? acquisition.histogram->count()
+		                              : acquisition.listMode->count()) *
+		    options.numIterations;
+		// A preview image is scaled up to the activity of all the events,
+		//  so it is only written once scaled
+		const bool scaleImages = acquisition.keptEventFraction < 1.0;
+		const auto reconstructImage = [&](const std::string& out_fname)
+		{
+			auto image = osem->reconstruct(scaleImages ? "" : out_fname);
+			if (scaleImages)
+			{
+				const ImageParams& imageParams = image->getParams();
+				const int64_t numVoxels =
+				    static_cast<int64_t>(imageParams.nx) * imageParams.ny *
+				    imageParams.nz;
+				const float scale =
+				    static_cast<float>(1.0 / acquisition.keptEventFraction);
+				float* voxels = image->getRawPointer();
+#pragma omp parallel for num_threads(globals::getNumThreads())
+				for (int64_t voxel_i = 0; voxel_i < numVoxels; voxel_i++)
+				{
+					voxels[voxel_i] *= scale;
+				}
+				if (!out_fname.empty())
+				{
+					image->writeToFile(out_fname);
+				}
+			}
+			return image;
+		};
+
+		std::vector<std::unique_ptr<ImageOwned>> images;
+		pr_profiler.beginStage("reconstruction");
+		if (useHistogram)
+		{
+			const TraceSpan span{"reconstruction"};
+			osem->setDataInput(acquisition.histogram.get());
+			images.push_back(reconstructImage(options.outImage_fname));
+		}
+		else if (acquisition.gates.empty())
+		{
+			const TraceSpan span{"reconstruction"};
+			osem->setDataInput(acquisition.listMode.get());
+			images.push_back(reconstructImage(options.outImage_fname));
+		}
+		else
+		{
+			// The sensitivity images do not depend on the events, so they
+			//  are shared by all the gates
+			for (size_t gate = 0; gate < acquisition.gates.size(); gate++)
+			{
+				const TraceSpan span{"reconstruction: gate"};
+				osem->setDataInput(acquisition.gates[gate].get());
+				images.push_back(reconstructImage(
+				    getIndexedFilename(options.outImage_fname, "gate", gate)));
+			}
+		}
+		pr_profiler.endStage(numReconItems, useHistogram ? "bins" : "events");
+		return images;
+	}
+
+	void writeSensitivityImages(const SensitivityImages& sensImages,
+	                            const std::string& out_fname)
+	{
+		if (sensImages.size() == 1)
+		{
+			sensImages[0]->writeToFile(out_fname);
+			return;
+		}
+		for (size_t subset_i = 0; subset_i < sensImages.size(); subset_i++)
+		{
+			sensImages[subset_i]->writeToFile(
+			    getIndexedFilename(out_fname, "subset", subset_i));
+		}
+	}
+
+	int getPreviewDownsampling(float previewFraction)
+	{
+		if (!(previewFraction > 0.0f && previewFraction < 1.0f))
+		{
+			return 1;
+		}
+		return std::clamp(
+		    static_cast<int>(std::lround(std::cbrt(1.0f / previewFraction))),
+		    1, 4);
+	}
+
+	ImageParams getDownsampledImageParams(const ImageParams& params,
+	                                      int downsampling)
+	{
+		if (downsampling <= 1)
+		{
+			return params;
+		}
+		const auto downsample = [downsampling](int n)
+		{ return std::max((n + downsampling - 1) / downsampling, 1); };
+		return ImageParams{downsample(params.nx), downsample(params.ny),
+		                   downsample(params.nz), params.length_x,
+		                   params.length_y,       params.length_z,
+		                   params.off_x,          params.off_y,
+		                   params.off_z};
+	}
+
+	std::string getIndexedFilename(const std::string& fname,
+	                               const std::string& label, size_t index)
+	{
+		std::filesystem::path path{fname};
+		path.replace_filename(path.stem().string() + "_" + label +
+		                      std::to_string(index) +
+		                      path.extension().string());
+		return path.string();
+	}
+}  // namespace yrt::petsird
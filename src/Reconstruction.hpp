@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Gating.hpp"
+#include "ListModeBinning.hpp"
+#include "PETSIRDListMode.hpp"
+#include "PETSIRDListModeView.hpp"
+#include "ReconstructionCaches.hpp"
+#include "ScannerContext.hpp"
+
+#include "yrt-pet/datastruct/projection/Histogram3D.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird
+{
+	class Profiler;
+	class ProgressReporter;
+
+	// Inputs, outputs and options of one reconstruction
+	struct ReconstructionOptions
+	{
+		std::string input_fname;
+		std::string imageParams_fname;
+		std::string outImage_fname;
+		std::string psfKernel_fname;
+		std::string attImage_fname;
+		std::string sensImage_fname;     // Pre-existing sensitivity image
+		std::string outSensImage_fname;
+		std::string outScannerLUT_fname;
+		// Decoded events in YRT-PET's list-mode format (See ListModeLUTWriter)
+		std::string outListMode_fname;
+		// Empty to disable the on-disk sensitivity cache
+		std::string sensCacheDir;
+		// Directory of the out-of-core event arrays (Empty to keep the
+		//  events in RAM)
+		std::string scratchDir;
+		bool useHugePages = false;
+		// See PETSIRDListMode::placeEventsForReconstruction
+		bool numaFirstTouch = false;
+		bool useTOF = false;
+		bool useGPU = false;
+		bool useNorm = false;
+		bool coalesceEvents = false;
+		int frameDuration_ms = 0;  // For the coalescing
+		bool chronologicalSubsets = false;
+		bool sortLORs = false;
+		// One image per gate, written next to the output image (with a
+		//  "_gate<i>" suffix). Incompatible with the coalescing, the LOR
+		//  sorting and the histogram mode
+		GatingOptions gating;
+		// Drop the events whose LOR misses the image (See
+		//  PETSIRDListMode::cullEventsOutsideFOV)
+		bool cullFOV = false;
+		// Apply the bed and gantry movements to the events (See
+		//  PETSIRDListMode::hasMotion)
+		bool motionCorrection = true;
+		DataMode dataMode = DataMode::Auto;
+		float histogramThreshold = DEFAULT_HISTOGRAM_MODE_THRESHOLD;
+		int numSubsets = 1;
+		int numIterations = 10;
+		// Below 1, quick-look reconstruction of a subsample of the events
+		//  (See PETSIRDListMode::setEventSubsampling) on a coarser grid and
+		//  without PSF
+		float previewFraction = 1.0f;
+	};
+
+	// Factor by which the preview coarsens the image grid in each
+	//  dimension. It keeps about the same number of events per voxel as the
+	//  full reconstruction: The cube root of 1 / fraction, between 1 and 4
+	int getPreviewDownsampling(float previewFraction);
+	// Same field of view, with the number of voxels divided by the factor
+	ImageParams getDownsampledImageParams(const ImageParams& params,
+	                                      int downsampling);
+
+	// "auto", "listmode" or "histogram"
+	DataMode parseDataMode(const std::string& dataMode_str);
+
+	// Overrides the options with the keys present in a job description
+	void applyReconstructionJob(const nlohmann::json& job,
+	                            ReconstructionOptions& options);
+
+	// Reads a job description. The keys are the long names of the options
+	//  of petsird_yrtpet_reconstruct ("input", "params", "out",
+	//  "num_subsets", ...). Missing keys keep the values of the defaults
+	ReconstructionOptions
+	    parseReconstructionJob(const nlohmann::json& job,
+	                           const ReconstructionOptions& defaults = {});
+
+	// Events of an acquisition, ready to be reconstructed
+	struct PreparedAcquisition
+	{
+		std::shared_ptr<const ScannerContext> scannerContext;
+		// Only one of the two is set, depending on the mode
+		std::unique_ptr<PETSIRDListMode> listMode;
+		std::unique_ptr<Histogram3DOwned> histogram;
+		// Views over the list-mode's events, one per gate (Empty if the
+		//  events are not gated)
+		std::vector<std::unique_ptr<PETSIRDListModeView>> gates;
+		// Fraction of the stream's events kept by the preview subsampling.
+		//  The images are divided by it to keep the scale of a full
+		//  reconstruction
+		double keptEventFraction = 1.0;
+	};
+
+	// Reads the input file, converts its scanner (or reuses it from the
+	//  caches, if given) and decodes the events. Depending on the mode, the
+	//  events are then either binned into a histogram or coalesced,
+	//  partitioned and sorted
+	PreparedAcquisition prepareAcquisition(const ReconstructionOptions& options,
+	                                       ReconstructionCaches* pp_caches,
+	                                       Profiler& pr_profiler,
+	                                       ProgressReporter& pr_progress);
+
+	// Gets the sensitivity images (from the caches, if given) and runs OSEM,
+	//  once per gate if the events are gated. Returns the images (one per
+	//  gate), also written to their files
+	std::vector<std::unique_ptr<ImageOwned>>
+	    reconstructAcquisition(const PreparedAcquisition& acquisition,
+	                           const ReconstructionOptions& options,
+	                           ReconstructionCaches* pp_caches,
+	                           Profiler& pr_profiler,
+	                           ProgressReporter& pr_progress);
+
+	// Writes the sensitivity images, one file per subset if there is more
+	//  than one
+	void writeSensitivityImages(const SensitivityImages& sensImages,
+	                            const std::string& out_fname);
+
+	// "dir/image.nii" with label "gate" and index 2 gives
+	//  "dir/image_gate2.nii"
+	std::string getIndexedFilename(const std::string& fname,
+	                               const std::string& label, size_t index);
+}  // namespace yrt::petsird
@@ -0,0 +1,65 @@
+#include "ReconstructionCaches.hpp"
+
+namespace yrt::petsird
+{
+	ReconstructionCaches::ReconstructionCaches(
+	    size_t maxNumScanners, size_t maxNumSensitivityImageSets)
+	    : m_scannerContexts(maxNumScanners),
+	      m_norms(maxNumScanners),
+	      m_sensitivityImages(maxNumSensitivityImageSets)
+	{
+	}
+
+	std::shared_ptr<const ScannerContext>
+	    ReconstructionCaches::getScannerContext(
+	        const ::petsird::ScannerInformation& scannerInfo)
+	{
+		const uint64_t scannerHash = hashScannerInformation(scannerInfo);
+		auto scannerContext = m_scannerContexts.get(scannerHash);
+		if (scannerContext == nullptr)
+		{
+			// Two threads missing at the same time both convert the scanner,
+			//  the last one replaces the entry
+			scannerContext =
+			    std::make_shared<const ScannerContext>(scannerInfo);
+			m_scannerContexts.put(scannerHash, scannerContext);
+		}
+		return scannerContext;
+	}
+
+	std::shared_ptr<const PETSIRDNorm> ReconstructionCaches::getNorm(
+	    const std::shared_ptr<const ScannerContext>& scannerContext)
+	{
+		const uint64_t scannerHash = scannerContext->getHash();
+		std::shared_ptr<const PETSIRDNorm> norm = m_norms.get(scannerHash);
+		if (norm == nullptr)
+		{
+			norm = scannerContext->createNorm();
+			m_norms.put(scannerHash, norm);
+		}
+		return norm;
+	}
+
+	std::shared_ptr<const SensitivityImages>
+	    ReconstructionCaches::getSensitivityImages(const std::string& key)
+	{
+		return m_sensitivityImages.get(key);
+	}
+
+	void ReconstructionCaches::storeSensitivityImages(
+	    const std::string& key,
+	    std::shared_ptr<const SensitivityImages> sensImages)
+	{
+		m_sensitivityImages.put(key, std::move(sensImages));
+	}
+
+	std::mutex& ReconstructionCaches::getSensitivityMutex()
+	{
+		return m_sensitivityMutex;
+	}
+
+	TimeBlockPool& ReconstructionCaches::getTimeBlockPool()
+	{
+		return m_timeBlockPool;
+	}
+}  // namespace yrt::petsird
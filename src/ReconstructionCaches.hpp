@@ -0,0 +1,57 @@
+#pragma once
+
+#include "LRUCache.hpp"
+#include "PETSIRDNorm.hpp"
+#include "ScannerContext.hpp"
+#include "TimeBlockPool.hpp"
+
+#include "yrt-pet/datastruct/image/Image.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird
+{
+	using SensitivityImages = std::vector<std::unique_ptr<Image>>;
+
+	// In-memory caches of the objects that can be reused between the
+	//  reconstructions of a long-running process: converted scanners and
+	//  normalisations (keyed by scanner hash) and sensitivity images (keyed
+	//  by sensitivity cache key, see SensitivityCache::computeKey)
+	class ReconstructionCaches
+	{
+	public:
+		ReconstructionCaches(size_t maxNumScanners,
+		                     size_t maxNumSensitivityImageSets);
+
+		// Converts the scanner on the first request
+		std::shared_ptr<const ScannerContext>
+		    getScannerContext(const ::petsird::ScannerInformation& scannerInfo);
+		// Creates the normalisation on the first request
+		std::shared_ptr<const PETSIRDNorm> getNorm(
+		    const std::shared_ptr<const ScannerContext>& scannerContext);
+
+		// Returns nullptr if the images are not in the cache
+		std::shared_ptr<const SensitivityImages>
+		    getSensitivityImages(const std::string& key);
+		void storeSensitivityImages(
+		    const std::string& key,
+		    std::shared_ptr<const SensitivityImages> sensImages);
+
+		// Held while looking up and generating sensitivity images, so that
+		//  concurrent reconstructions generate each set only once
+		std::mutex& getSensitivityMutex();
+
+		// Time block batches shared by the ingests of the process
+		TimeBlockPool& getTimeBlockPool();
+
+	private:
+		LRUCache<uint64_t, const ScannerContext> m_scannerContexts;
+		LRUCache<uint64_t, const PETSIRDNorm> m_norms;
+		LRUCache<std::string, const SensitivityImages> m_sensitivityImages;
+		TimeBlockPool m_timeBlockPool;
+		std::mutex m_sensitivityMutex;
+	};
+}  // namespace yrt::petsird
@@ -0,0 +1,109 @@
+#include "ScannerContext.hpp"
+
+#include "petsird_helpers.h"
+
+namespace yrt::petsird
+{
+	ScannerContext::ScannerContext(
+	    const ::petsird::ScannerInformation& scannerInfo)
+	    : m_scannerInfo(scannerInfo),
+	      m_hash(hashScannerInformation(scannerInfo))
+	{
+		auto [scanner, correspondenceMap] = toScanner(m_scannerInfo);
+		mp_scanner = std::make_unique<Scanner>(std::move(scanner));
+		m_correspondenceMap = std::move(correspondenceMap);
+
+		// Reverse lookups, done once instead of for every normalisation bin
+		const size_t numDets = mp_scanner->getNumDets();
+		m_detectorTypes.resize(numDets);
+		m_detectionBins.resize(numDets);
+		for (det_id_t d = 0; d < numDets; d++)
+		{
+			const auto [type, module, element] =
+			    m_correspondenceMap.getDetectorFromFlatIndex(d);
+			::petsird::ExpandedDetectionBin expandedBin{};
+			expandedBin.module_index = module;
+			expandedBin.element_index = element;
+			// TODO: Support energy level
+			m_detectorTypes[d] = type;
+			m_detectionBins[d] = petsird_helpers::make_detection_bin(
+			    m_scannerInfo, type, expandedBin);
+		}
+
+		// The TOF bin edges are in mm
+		const size_t numTypes = m_scannerInfo.tof_bin_edges.size();
+		m_tofBinCenters.resize(numTypes * numTypes);
+		for (size_t type0 = 0; type0 < numTypes; type0++)
+		{
+			for (size_t type1 = 0; type1 < numTypes; type1++)
+			{
+				const auto& edges =
+				    m_scannerInfo.tof_bin_edges[type0][type1].edges;
+				std::vector<float>& centers =
+				    m_tofBinCenters[type0 * numTypes + type1];
+				for (size_t bin_i = 0; bin_i + 1 < edges.size(); bin_i++)
+				{
+					const float center_mm =
+					    0.5f * (edges[bin_i] + edges[bin_i + 1]);
+					centers.push_back(center_mm * 2.0f / SPEED_OF_LIGHT_MM_PS);
+				}
+			}
+		}
+	}
+
+	const ::petsird::ScannerInformation&
+	    ScannerContext::getScannerInformation() const
+	{
+		return m_scannerInfo;
+	}
+
+	const Scanner& ScannerContext::getScanner() const
+	{
+		return *mp_scanner;
+	}
+
+	const DetectorCorrespondenceMap&
+	    ScannerContext::getCorrespondenceMap() const
+	{
+		return m_correspondenceMap;
+	}
+
+	uint64_t ScannerContext::getHash() const
+	{
+		return m_hash;
+	}
+
+	const std::vector<::petsird::TypeOfModule>&
+	    ScannerContext::getDetectorTypes() const
+	{
+		return m_detectorTypes;
+	}
+
+	const std::vector<::petsird::DetectionBin>&
+	    ScannerContext::getDetectionBins() const
+	{
+		return m_detectionBins;
+	}
+
+	const std::vector<float>&
+	    ScannerContext::getTOFBinCenters(::petsird::TypeOfModule type0,
+	                                     ::petsird::TypeOfModule type1) const
+	{
+		const size_t numTypes = m_scannerInfo.tof_bin_edges.size();
+		return m_tofBinCenters.at(type0 * numTypes + type1);
+	}
+
+	std::unique_ptr<PETSIRDListMode>
+	    ScannerContext::createListMode(const TimeBlockCollection& timeBlocks,
+	                                   bool useTOF,
+	                                   const EventStorageOptions& storage) const
+	{
+		return std::make_unique<PETSIRDListMode>(shared_from_this(),
+		                                         timeBlocks, useTOF, storage);
+	}
+
+	std::unique_ptr<PETSIRDNorm> ScannerContext::createNorm() const
+	{
+		return std::make_unique<PETSIRDNorm>(shared_from_this());
+	}
+}  // namespace yrt::petsird
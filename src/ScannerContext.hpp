@@ -0,0 +1,61 @@
+#pragma once
+
+#include "DetectorCorrespondenceMap.hpp"
+#include "PETSIRDListMode.hpp"
+#include "PETSIRDNorm.hpp"
+#include "utils.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird
+{
+	// PETSIRD scanner description converted once into a YRT-PET Scanner and
+	//  its detector correspondence. It is immutable and shared (through
+	//  std::shared_ptr) by the list modes and normalisations it creates, so a
+	//  process holds a single copy per scanner whatever the number of
+	//  acquisitions or frames. It must be owned by a std::shared_ptr
+	class ScannerContext : public std::enable_shared_from_this<ScannerContext>
+	{
+	public:
+		explicit ScannerContext(
+		    const ::petsird::ScannerInformation& scannerInfo);
+
+		// Not copyable nor movable: The objects it creates refer to it
+		ScannerContext(const ScannerContext&) = delete;
+		ScannerContext& operator=(const ScannerContext&) = delete;
+
+		const ::petsird::ScannerInformation& getScannerInformation() const;
+		const Scanner& getScanner() const;
+		const DetectorCorrespondenceMap& getCorrespondenceMap() const;
+		// See hashScannerInformation
+		uint64_t getHash() const;
+
+		// Module type and detection bin (at the first energy bin) of each
+		//  YRT-PET detector, indexed by detector
+		const std::vector<::petsird::TypeOfModule>& getDetectorTypes() const;
+		const std::vector<::petsird::DetectionBin>& getDetectionBins() const;
+		// TOF (in ps) at the center of each TOF bin of the module type pair
+		const std::vector<float>&
+		    getTOFBinCenters(::petsird::TypeOfModule type0,
+		                     ::petsird::TypeOfModule type1) const;
+
+		// The created objects share the ownership of the context
+		std::unique_ptr<PETSIRDListMode>
+		    createListMode(const TimeBlockCollection& timeBlocks,
+		                   bool useTOF = false,
+		                   const EventStorageOptions& storage = {}) const;
+		std::unique_ptr<PETSIRDNorm> createNorm() const;
+
+	private:
+		const ::petsird::ScannerInformation m_scannerInfo;
+		std::unique_ptr<Scanner> mp_scanner;
+		DetectorCorrespondenceMap m_correspondenceMap;
+		std::vector<::petsird::TypeOfModule> m_detectorTypes;
+		std::vector<::petsird::DetectionBin> m_detectionBins;
+		// Indexed by type0 * number of types + type1
+		std::vector<std::vector<float>> m_tofBinCenters;
+		uint64_t m_hash;
+	};
+}  // namespace yrt::petsird
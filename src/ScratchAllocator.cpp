@@ -0,0 +1,151 @@
+#include "ScratchAllocator.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace yrt::petsird
+{
+	void checkEventStorageOptions(const EventStorageOptions& storage)
+	{
+#if !defined(__unix__) && !defined(__APPLE__)
+		if (!storage.scratchDir.empty())
+		{
+			throw std::invalid_argument(
+			    "Scratch files are not supported on this platform");
+		}
+		if (storage.useHugePages)
+		{
+			throw std::invalid_argument(
+			    "Huge pages are not supported on this platform");
+		}
+#else
+		(void)storage;
+#endif
+	}
+
+#if defined(__unix__) || defined(__APPLE__)
+	void* allocateScratch(const std::string& scratchDir, size_t numBytes)
+	{
+		std::filesystem::create_directories(scratchDir);
+		const std::string pattern =
+		    (std::filesystem::path{scratchDir} / "yrtpet_petsird_XXXXXX")
+		        .string();
+		std::vector<char> fname(pattern.begin(), pattern.end());
+		fname.push_back('\0');
+
+		const int fd = mkstemp(fname.data());
+		if (fd < 0)
+		{
+			throw std::runtime_error("Could not create a scratch file in " +
+			                         scratchDir + ": " + std::strerror(errno));
+		}
+		// The mapping keeps the file alive, and the space is freed when it
+		//  is unmapped (Including when the process dies)
+		unlink(fname.data());
+
+		if (ftruncate(fd, static_cast<off_t>(numBytes)) != 0)
+		{
+			const int error = errno;
+			close(fd);
+			throw std::runtime_error("Could not allocate " +
+			                         std::to_string(numBytes) +
+			                         " bytes in " + scratchDir + ": " +
+			                         std::strerror(error));
+		}
+		void* ptr = mmap(nullptr, numBytes, PROT_READ | PROT_WRITE,
+		                 MAP_SHARED, fd, 0);
+		const int error = errno;
+		close(fd);
+		if (ptr == MAP_FAILED)
+		{
+			throw std::runtime_error("Could not map a scratch file of " +
+			                         scratchDir + ": " +
+			                         std::strerror(error));
+		}
+		// The events are mostly read in order
+		madvise(ptr, numBytes, MADV_SEQUENTIAL);
+		return ptr;
+	}
+
+	void deallocateScratch(void* ptr, size_t numBytes)
+	{
+		munmap(ptr, numBytes);
+	}
+
+	void prefetchScratch(const void* ptr, size_t numBytes)
+	{
+		// madvise requires a page-aligned address
+		const uintptr_t pageSize =
+		    static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+		const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+		const uintptr_t alignedBegin = begin / pageSize * pageSize;
+		madvise(reinterpret_cast<void*>(alignedBegin),
+		        numBytes + (begin - alignedBegin), MADV_WILLNEED);
+	}
+
+	void* allocateHugePages(size_t numBytes)
+	{
+		constexpr size_t HugePageSize = size_t{2} << 20;
+		const size_t alignedBytes =
+		    (numBytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+		void* ptr = nullptr;
+		if (posix_memalign(&ptr, HugePageSize, alignedBytes) != 0)
+		{
+			throw std::bad_alloc();
+		}
+#if defined(MADV_HUGEPAGE)
+		madvise(ptr, alignedBytes, MADV_HUGEPAGE);
+#endif
+		return ptr;
+	}
+
+	void deallocateHugePages(void* ptr)
+	{
+		std::free(ptr);
+	}
+#else
+	// Rejected by checkEventStorageOptions, so never reached
+	void* allocateScratch(const std::string& scratchDir, size_t numBytes)
+	{
+		(void)numBytes;
+		throw std::runtime_error("Could not create a scratch file in " +
+		                         scratchDir +
+		                         ": Not supported on this platform");
+	}
+
+	void deallocateScratch(void* ptr, size_t numBytes)
+	{
+		(void)ptr;
+		(void)numBytes;
+	}
+
+	void prefetchScratch(const void* ptr, size_t numBytes)
+	{
+		(void)ptr;
+		(void)numBytes;
+	}
+
+	void* allocateHugePages(size_t numBytes)
+	{
+		(void)numBytes;
+		throw std::runtime_error(
+		    "Huge pages are not supported on this platform");
+	}
+
+	void deallocateHugePages(void* ptr)
+	{
+		(void)ptr;
+	}
+#endif
+}  // namespace yrt::petsird
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace yrt::petsird
+{
+	// Allocations at least this large go to the scratch directory or to huge
+	//  pages
+	constexpr size_t SCRATCH_MIN_BYTES = size_t{16} << 20;
+
+	// Placement of the large event arrays
+	struct EventStorageOptions
+	{
+		// Directory of the memory-mapped files (Empty to use the RAM)
+		std::string scratchDir;
+		// Transparent huge pages hint for the arrays in RAM
+		bool useHugePages = false;
+	};
+
+	// Throws if the placement is not supported on this platform (Scratch
+	//  files and huge pages need a UNIX-like system)
+	void checkEventStorageOptions(const EventStorageOptions& storage);
+
+	// Memory mapped on a new (unlinked) file of the directory. The kernel
+	//  writes the pages back to the file and evicts them under memory
+	//  pressure, so the mapped size is bounded by the disk instead of the RAM
+	void* allocateScratch(const std::string& scratchDir, size_t numBytes);
+	void deallocateScratch(void* ptr, size_t numBytes);
+	// Starts reading the pages of the range in the background
+	void prefetchScratch(const void* ptr, size_t numBytes);
+	// Memory aligned on huge pages, with a hint to back it with transparent
+	//  huge pages
+	void* allocateHugePages(size_t numBytes);
+	void deallocateHugePages(void* ptr);
+
+	// Allocator of the event arrays. The large arrays are placed according
+	//  to the storage options (Otherwise, or for small arrays, it uses the
+	//  heap). Elements constructed without a value are default-initialized,
+	//  so that resizing does not write (first touch) the new memory
+	template <typename T>
+	class ScratchAllocator
+	{
+	public:
+		using value_type = T;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		ScratchAllocator() = default;
+		explicit ScratchAllocator(
+		    std::shared_ptr<const EventStorageOptions> storage)
+		    : mp_storage(std::move(storage))
+		{
+			if (mp_storage != nullptr)
+			{
+				checkEventStorageOptions(*mp_storage);
+			}
+		}
+		template <typename U>
+		ScratchAllocator(const ScratchAllocator<U>& other)
+		    : mp_storage(other.getStorageOptions())
+		{
+		}
+
+		T* allocate(size_t n)
+		{
+			if (usesScratch(n))
+			{
+				return static_cast<T*>(
+				    allocateScratch(mp_storage->scratchDir, n * sizeof(T)));
+			}
+			if (usesHugePages(n))
+			{
+				return static_cast<T*>(allocateHugePages(n * sizeof(T)));
+			}
+			return std::allocator<T>{}.allocate(n);
+		}
+
+		void deallocate(T* ptr, size_t n)
+		{
+			if (usesScratch(n))
+			{
+				deallocateScratch(ptr, n * sizeof(T));
+				return;
+			}
+			if (usesHugePages(n))
+			{
+				deallocateHugePages(ptr);
+				return;
+			}
+			std::allocator<T>{}.deallocate(ptr, n);
+		}
+
+		template <typename U>
+		void construct(U* ptr)
+		{
+			::new (static_cast<void*>(ptr)) U;
+		}
+		template <typename U, typename... Args>
+		void construct(U* ptr, Args&&... args)
+		{
+			::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+		}
+
+		// Whether an array of n elements is in the scratch directory
+		bool usesScratch(size_t n) const
+		{
+			return mp_storage != nullptr && !mp_storage->scratchDir.empty() &&
+			       n * sizeof(T) >= SCRATCH_MIN_BYTES;
+		}
+		bool usesHugePages(size_t n) const
+		{
+			return mp_storage != nullptr && mp_storage->useHugePages &&
+			       !usesScratch(n) && n * sizeof(T) >= SCRATCH_MIN_BYTES;
+		}
+
+		const std::shared_ptr<const EventStorageOptions>&
+		    getStorageOptions() const
+		{
+			return mp_storage;
+		}
+
+	private:
+		// Null to always use the heap
+		std::shared_ptr<const EventStorageOptions> mp_storage;
+	};
+
+	// Memory allocated by one allocator can be freed by the other
+	template <typename T, typename U>
+	bool operator==(const ScratchAllocator<T>& a, const ScratchAllocator<U>& b)
+	{
+		const auto getPlacement = [](const EventStorageOptions* storage)
+		{
+			return std::make_pair(
+			    storage != nullptr && !storage->scratchDir.empty(),
+			    storage != nullptr && storage->useHugePages);
+		};
+		return getPlacement(a.getStorageOptions().get()) ==
+		       getPlacement(b.getStorageOptions().get());
+	}
+	template <typename T, typename U>
+	bool operator!=(const ScratchAllocator<T>& a, const ScratchAllocator<U>& b)
+	{
+		return !(a == b);
+	}
+
+	// Array of per-event values, optionally out-of-core
+	template <typename T>
+	using EventVector = std::vector<T, ScratchAllocator<T>>;
+
+	// Prefetches the elements [begin, end) if they are in the scratch
+	//  directory
+	template <typename T>
+	void prefetchEvents(const EventVector<T>& values, size_t begin, size_t end)
+	{
+		if (begin < end &&
+		    values.get_allocator().usesScratch(values.capacity()))
+		{
+			prefetchScratch(values.data() + begin, (end - begin) * sizeof(T));
+		}
+	}
+}  // namespace yrt::petsird
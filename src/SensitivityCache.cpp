@@ -0,0 +1,149 @@
+#include "SensitivityCache.hpp"
+
+#include "Hasher.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace yrt::petsird
+{
+	SensitivityCache::SensitivityCache(std::string p_cacheDir)
+	    : m_cacheDir(std::move(p_cacheDir))
+	{
+	}
+
+	std::string SensitivityCache::getDefaultCacheDirectory()
+	{
+		if (const char* cacheDir = std::getenv("YRTPET_PETSIRD_CACHE_DIR"))
+		{
+			return cacheDir;
+		}
+		if (const char* xdgCacheHome = std::getenv("XDG_CACHE_HOME"))
+		{
+			return (fs::path{xdgCacheHome} / "yrt-pet-petsird").string();
+		}
+		if (const char* home = std::getenv("HOME"))
+		{
+			return (fs::path{home} / ".cache" / "yrt-pet-petsird").string();
+		}
+		return "";
+	}
+
+	std::string
+	    SensitivityCache::computeKey(const SensitivityCacheKeyInputs& inputs)
+	{
+		Hasher hasher;
+		hasher.updateValue(inputs.scannerHash);
+		hasher.updateFile(inputs.imageParams_fname);
+
+		hasher.updateValue(!inputs.psfKernel_fname.empty());
+		if (!inputs.psfKernel_fname.empty())
+		{
+			hasher.updateFile(inputs.psfKernel_fname);
+		}
+
+		hasher.updateValue(!inputs.attImage_fname.empty());
+		if (!inputs.attImage_fname.empty())
+		{
+			hasher.updateFile(inputs.attImage_fname);
+		}
+
+		hasher.updateValue(inputs.useNorm);
+		hasher.updateValue(inputs.useTOF);
+		hasher.updateValue(inputs.listModeEnabled);
+		hasher.updateValue(inputs.numSubsets);
+		// Only hashed when used, so that the keys of full grids are unchanged
+		if (inputs.imageDownsampling != 1)
+		{
+			hasher.updateValue(inputs.imageDownsampling);
+		}
+
+		return hasher.hexDigest();
+	}
+
+	bool SensitivityCache::load(
+	    const std::string& key, size_t numImages,
+	    std::vector<std::unique_ptr<Image>>& sensImages) const
+	{
+		const fs::path entryDir = fs::path{m_cacheDir} / key;
+
+		for (size_t image_i = 0; image_i < numImages; image_i++)
+		{
+			if (!fs::exists(entryDir / getImageFilename(image_i)))
+			{
+				return false;
+			}
+		}
+
+		std::vector<std::unique_ptr<Image>> loadedImages;
+		loadedImages.reserve(numImages);
+		for (size_t image_i = 0; image_i < numImages; image_i++)
+		{
+			loadedImages.push_back(std::make_unique<ImageOwned>(
+			    (entryDir / getImageFilename(image_i)).string()));
+		}
+
+		for (auto& loadedImage : loadedImages)
+		{
+			sensImages.push_back(std::move(loadedImage));
+		}
+		return true;
+	}
+
+	void SensitivityCache::store(
+	    const std::string& key,
+	    const std::vector<std::unique_ptr<Image>>& sensImages) const
+	{
+		const fs::path entryDir = fs::path{m_cacheDir} / key;
+		// Unique to this writer, so that concurrent processes storing the
+		//  same entry do not write into the same directory
+		std::random_device randomDevice;
+		const uint64_t tmpSuffix =
+		    (static_cast<uint64_t>(randomDevice()) << 32) ^ randomDevice();
+		const fs::path tmpDir = fs::path{m_cacheDir} /
+		                        (key + ".tmp" + std::to_string(tmpSuffix));
+
+		try
+		{
+			fs::create_directories(tmpDir);
+			for (size_t image_i = 0; image_i < sensImages.size(); image_i++)
+			{
+				sensImages[image_i]->writeToFile(
+				    (tmpDir / getImageFilename(image_i)).string());
+			}
+
+			std::error_code ec;
+			fs::rename(tmpDir, entryDir, ec);
+			if (ec)
+			{
+				// Another process stored the same entry first
+				fs::remove_all(tmpDir);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			// Failing to populate the cache should never fail the
+			//  reconstruction
+			std::cerr << "Warning: Could not store sensitivity images in "
+			             "cache: "
+			          << e.what() << std::endl;
+			std::error_code ec;
+			fs::remove_all(tmpDir, ec);
+		}
+	}
+
+	const std::string& SensitivityCache::getCacheDirectory() const
+	{
+		return m_cacheDir;
+	}
+
+	std::string SensitivityCache::getImageFilename(size_t image_i)
+	{
+		return "sens_" + std::to_string(image_i) + ".nii";
+	}
+}  // namespace yrt::petsird
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "petsird/types.h"
+#include "yrt-pet/datastruct/image/Image.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird
+{
+	// Everything that influences the content of the sensitivity images
+	struct SensitivityCacheKeyInputs
+	{
+		uint64_t scannerHash;
+		std::string imageParams_fname;
+		std::string psfKernel_fname;  // Empty if no PSF
+		std::string attImage_fname;   // Empty if no attenuation
+		bool useNorm;
+		bool useTOF;
+		bool listModeEnabled;
+		int numSubsets;
+		// Factor by which the image grid is coarsened (1 for the grid of
+		//  the image parameters file)
+		int imageDownsampling = 1;
+	};
+
+	// Content-addressed on-disk cache of generated sensitivity images.
+	// Each entry is a directory named after the key, containing one image per
+	//  sensitivity image expected by the reconstruction
+	class SensitivityCache
+	{
+	public:
+		explicit SensitivityCache(std::string p_cacheDir);
+
+		// Directory used when none is specified. Uses, in order of priority,
+		//  YRTPET_PETSIRD_CACHE_DIR, XDG_CACHE_HOME and HOME. Returns an empty
+		//  string if none of these are defined
+		static std::string getDefaultCacheDirectory();
+
+		static std::string computeKey(const SensitivityCacheKeyInputs& inputs);
+
+		// Returns false if the entry does not exist or is incomplete
+		bool load(const std::string& key, size_t numImages,
+		          std::vector<std::unique_ptr<Image>>& sensImages) const;
+
+		// Writes the images atomically (An incomplete entry is never
+		//  visible to other processes)
+		void store(const std::string& key,
+		           const std::vector<std::unique_ptr<Image>>& sensImages) const;
+
+		const std::string& getCacheDirectory() const;
+
+	private:
+		static std::string getImageFilename(size_t image_i);
+
+		std::string m_cacheDir;
+	};
+}  // namespace yrt::petsird
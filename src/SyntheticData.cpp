@@ -0,0 +1,278 @@
+#include "SyntheticData.hpp"
+
+#include "petsird_helpers.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace yrt::petsird
+{
+	namespace
+	{
+		// M_PI is not standard C++
+		constexpr float Pi = 3.14159265358979f;
+
+		// Rotation around Z followed by a translation
+		::petsird::RigidTransformation makeTransform(float angle, float tx,
+		                                             float ty, float tz)
+		{
+			const float c = std::cos(angle);
+			const float s = std::sin(angle);
+			const float values[3][4] = {
+			    {c, -s, 0.0f, tx}, {s, c, 0.0f, ty}, {0.0f, 0.0f, 1.0f, tz}};
+
+			::petsird::RigidTransformation transform;
+			for (size_t row = 0; row < 3; row++)
+			{
+				for (size_t col = 0; col < 4; col++)
+				{
+					transform.matrix(row, col) = values[row][col];
+				}
+			}
+			return transform;
+		}
+
+		::petsird::BoxSolidVolume
+		    makeCrystal(const SyntheticScannerOptions& options)
+		{
+			// Box centered on the origin, the depth is along X
+			const float hx = 0.5f * options.crystalDepth;
+			const float hy = 0.5f * options.crystalSize_trans;
+			const float hz = 0.5f * options.crystalSize_z;
+
+			::petsird::BoxSolidVolume crystal;
+			size_t corner_i = 0;
+			for (const float x : {-hx, hx})
+			{
+				for (const float y : {-hy, hy})
+				{
+					for (const float z : {-hz, hz})
+					{
+						crystal.shape.corners[corner_i++] =
+						    ::petsird::Coordinate{{x, y, z}};
+					}
+				}
+			}
+			crystal.material_id = 1;
+			return crystal;
+		}
+
+		::petsird::DetectorModule
+		    makeModule(const SyntheticScannerOptions& options)
+		{
+			const auto centeredOffset = [](size_t index, size_t count,
+			                               float pitch)
+			{
+				return (static_cast<float>(index) -
+				        0.5f * static_cast<float>(count - 1)) *
+				       pitch;
+			};
+
+			::petsird::ReplicatedBoxSolidVolume crystals;
+			crystals.object = makeCrystal(options);
+			for (size_t axial_i = 0; axial_i < options.numCrystalsAxial;
+			     axial_i++)
+			{
+				for (size_t trans_i = 0; trans_i < options.numCrystalsTrans;
+				     trans_i++)
+				{
+					const float y =
+					    centeredOffset(trans_i, options.numCrystalsTrans,
+					                   options.crystalSize_trans);
+					const float z =
+					    centeredOffset(axial_i, options.numCrystalsAxial,
+					                   options.crystalSize_z);
+					crystals.transforms.push_back(
+					    makeTransform(0.0f, 0.0f, y, z));
+				}
+			}
+
+			::petsird::DetectorModule detectorModule;
+			detectorModule.detecting_elements = crystals;
+			return detectorModule;
+		}
+
+		::petsird::BinEdges makeUniformBinEdges(float minValue,
+		                                        float maxValue, size_t numBins)
+		{
+			yardl::NDArray<float, 1>::shape_type shape = {numBins + 1};
+			yardl::NDArray<float, 1> edges(shape);
+			for (size_t i = 0; i <= numBins; i++)
+			{
+				edges[i] = minValue + (maxValue - minValue) *
+				                          static_cast<float>(i) /
+				                          static_cast<float>(numBins);
+			}
+			::petsird::BinEdges binEdges;
+			binEdges.edges = edges;
+			return binEdges;
+		}
+
+		size_t getNumModuleRingsOfType(const SyntheticScannerOptions& options,
+		                               size_t moduleType)
+		{
+			return (options.numModuleRings - moduleType +
+			        options.numModuleTypes - 1) /
+			       options.numModuleTypes;
+		}
+	}  // namespace
+
+	::petsird::ScannerInformation
+	    makeSyntheticScannerInformation(const SyntheticScannerOptions& options)
+	{
+		::petsird::ScannerInformation scannerInfo;
+		scannerInfo.model_name = "PETSIRD_SYNTHETIC";
+
+		const float modulePitch_z =
+		    static_cast<float>(options.numCrystalsAxial) *
+		    options.crystalSize_z;
+		const float moduleCenterRadius =
+		    options.radius + 0.5f * options.crystalDepth;
+
+		for (size_t type_i = 0; type_i < options.numModuleTypes; type_i++)
+		{
+			::petsird::ReplicatedDetectorModule replicatedModule;
+			replicatedModule.object = makeModule(options);
+
+			for (size_t ring_i = type_i; ring_i < options.numModuleRings;
+			     ring_i += options.numModuleTypes)
+			{
+				const float z =
+				    (static_cast<float>(ring_i) -
+				     0.5f * static_cast<float>(options.numModuleRings - 1)) *
+				    modulePitch_z;
+				for (size_t module_i = 0; module_i < options.numModulesPerRing;
+				     module_i++)
+				{
+					const float angle =
+					    2.0f * Pi * static_cast<float>(module_i) /
+					    static_cast<float>(options.numModulesPerRing);
+					replicatedModule.transforms.push_back(makeTransform(
+					    angle, moduleCenterRadius * std::cos(angle),
+					    moduleCenterRadius * std::sin(angle), z));
+				}
+			}
+			scannerInfo.scanner_geometry.replicated_modules.push_back(
+			    replicatedModule);
+		}
+
+		// TOF and energy information
+		const size_t numTypes = options.numModuleTypes;
+		const float maxTOFDistance = options.radius;  // in mm
+		scannerInfo.tof_bin_edges.resize(numTypes);
+		scannerInfo.tof_resolution.resize(numTypes);
+		for (size_t type0 = 0; type0 < numTypes; type0++)
+		{
+			for (size_t type1 = 0; type1 < numTypes; type1++)
+			{
+				scannerInfo.tof_bin_edges[type0].push_back(makeUniformBinEdges(
+				    -maxTOFDistance, maxTOFDistance, options.numTOFBins));
+				scannerInfo.tof_resolution[type0].push_back(
+				    2.0f * maxTOFDistance /
+				    static_cast<float>(options.numTOFBins));  // in mm
+			}
+			scannerInfo.event_energy_bin_edges.push_back(
+			    makeUniformBinEdges(430.0f, 650.0f, options.numEnergyBins));
+			scannerInfo.energy_resolution_at_511.push_back(0.11f);
+		}
+
+		if (options.withEfficiencies)
+		{
+			// Deterministic efficiencies between 0.8 and 1.2
+			SplitMix64 rng{options.seed ^ 0xEFF1C1E9C1E5ull};
+			std::vector<::petsird::DetectionBinEfficiencies> efficiencies;
+			for (size_t type_i = 0; type_i < numTypes; type_i++)
+			{
+				const size_t numBins =
+				    ::petsird_helpers::get_num_det_els(scannerInfo, type_i) *
+				    options.numEnergyBins;
+				::petsird::DetectionBinEfficiencies::shape_type shape = {
+				    numBins};
+				::petsird::DetectionBinEfficiencies binEfficiencies(shape);
+				for (size_t bin_i = 0; bin_i < numBins; bin_i++)
+				{
+					const float random01 =
+					    static_cast<float>(rng.nextBelow(1 << 20)) /
+					    static_cast<float>(1 << 20);
+					binEfficiencies[bin_i] = 0.8f + 0.4f * random01;
+				}
+				efficiencies.push_back(binEfficiencies);
+			}
+			scannerInfo.detection_efficiencies.detection_bin_efficiencies =
+			    efficiencies;
+		}
+
+		return scannerInfo;
+	}
+
+	void fillSyntheticEventTimeBlock(
+	    const SyntheticScannerOptions& options,
+	    const ::petsird::ScannerInformation& scannerInfo, uint64_t timeBlock_i,
+	    size_t numEvents, ::petsird::EventTimeBlock& eventTimeBlock)
+	{
+		const size_t numTypes = options.numModuleTypes;
+		const size_t numModulesPerRing = options.numModulesPerRing;
+		const uint32_t numCrystalsPerModule = static_cast<uint32_t>(
+		    options.numCrystalsTrans * options.numCrystalsAxial);
+		const size_t maxModuleOffset =
+		    std::max<size_t>(numModulesPerRing / 4, 1);
+
+		SplitMix64 rng{options.seed +
+		               0x9E3779B97F4A7C15ull * (timeBlock_i + 1)};
+
+		eventTimeBlock.time_interval.start =
+		    static_cast<uint32_t>(timeBlock_i);
+		eventTimeBlock.time_interval.stop =
+		    static_cast<uint32_t>(timeBlock_i + 1);
+
+		auto& promptEvents = eventTimeBlock.prompt_events;
+		promptEvents.resize(numTypes);
+		for (auto& promptEvents_type0 : promptEvents)
+		{
+			promptEvents_type0.resize(numTypes);
+			for (auto& promptEvents_type01 : promptEvents_type0)
+			{
+				promptEvents_type01.clear();
+			}
+		}
+
+		for (size_t event_i = 0; event_i < numEvents; event_i++)
+		{
+			const uint32_t type0 = rng.nextBelow(numTypes);
+			const uint32_t type1 = rng.nextBelow(numTypes);
+
+			const uint32_t around0 = rng.nextBelow(numModulesPerRing);
+			const uint32_t around1 = static_cast<uint32_t>(
+			    (around0 + numModulesPerRing / 2 + numModulesPerRing +
+			     rng.nextBelow(2 * maxModuleOffset + 1) - maxModuleOffset) %
+			    numModulesPerRing);
+
+			const uint32_t ring0 =
+			    rng.nextBelow(getNumModuleRingsOfType(options, type0));
+			const uint32_t ring1 =
+			    rng.nextBelow(getNumModuleRingsOfType(options, type1));
+
+			::petsird::ExpandedDetectionBin expanded0{};
+			expanded0.module_index = static_cast<uint32_t>(
+			    ring0 * numModulesPerRing + around0);
+			expanded0.element_index = rng.nextBelow(numCrystalsPerModule);
+			expanded0.energy_index = rng.nextBelow(options.numEnergyBins);
+
+			::petsird::ExpandedDetectionBin expanded1{};
+			expanded1.module_index = static_cast<uint32_t>(
+			    ring1 * numModulesPerRing + around1);
+			expanded1.element_index = rng.nextBelow(numCrystalsPerModule);
+			expanded1.energy_index = rng.nextBelow(options.numEnergyBins);
+
+			::petsird::CoincidenceEvent event;
+			event.detection_bins = {
+			    ::petsird_helpers::make_detection_bin(scannerInfo, type0,
+			                                          expanded0),
+			    ::petsird_helpers::make_detection_bin(scannerInfo, type1,
+			                                          expanded1)};
+			event.tof_idx = rng.nextBelow(options.numTOFBins);
+
+			promptEvents[type0][type1].push_back(event);
+		}
+	}
+}  // namespace yrt::petsird
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "petsird/types.h"
+
+#include <cstdint>
+
+/*
+ * Synthetic PETSIRD scanner and prompt events, used to measure the ingest
+ * and reconstruction throughput without patient data.
+ *
+ * Geometry:
+ * - The scanner is made of axial rings of modules, each ring containing the
+ *    same number of modules around the Z axis
+ * - Module ring r uses the module type r % numModuleTypes
+ * - Each module is a grid of crystals (transaxial x axial)
+ * - The crystals are oriented radially (their depth is along the radius)
+ * */
+
+namespace yrt::petsird
+{
+	struct SyntheticScannerOptions
+	{
+		size_t numModuleRings = 4;
+		size_t numModulesPerRing = 32;
+		size_t numCrystalsTrans = 8;
+		size_t numCrystalsAxial = 8;
+		size_t numModuleTypes = 1;
+		size_t numTOFBins = 21;
+		size_t numEnergyBins = 1;
+		uint64_t seed = 0;
+		float radius = 400.0f;           // in mm
+		float crystalSize_trans = 4.0f;  // in mm
+		float crystalSize_z = 4.0f;      // in mm
+		float crystalDepth = 20.0f;      // in mm
+		bool withEfficiencies = false;
+	};
+
+	// SplitMix64 generator: Deterministic across platforms and compilers
+	class SplitMix64
+	{
+	public:
+		explicit SplitMix64(uint64_t seed) : m_state(seed) {}
+
+		uint64_t next()
+		{
+			uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		// Integer in [0, n) (The modulo bias is negligible for small n)
+		uint32_t nextBelow(uint64_t n)
+		{
+			return static_cast<uint32_t>(next() % n);
+		}
+
+	private:
+		uint64_t m_state;
+	};
+
+	::petsird::ScannerInformation
+	    makeSyntheticScannerInformation(const SyntheticScannerOptions& options);
+
+	// Fills the time block with pseudo-random prompts between modules facing
+	//  each other. The content only depends on the seed and the block index.
+	//  The event vectors of the time block are reused (keeping their capacity)
+	void fillSyntheticEventTimeBlock(
+	    const SyntheticScannerOptions& options,
+	    const ::petsird::ScannerInformation& scannerInfo, uint64_t timeBlock_i,
+	    size_t numEvents, ::petsird::EventTimeBlock& eventTimeBlock);
+}  // namespace yrt::petsird
@@ -0,0 +1,43 @@
+#include "TimeBlockPool.hpp"
+
+#include <algorithm>
+
+namespace yrt::petsird
+{
+	TimeBlockPool::TimeBlockPool(size_t timeBlocksPerBatch)
+	    : m_timeBlocksPerBatch(std::max<size_t>(timeBlocksPerBatch, 1))
+	{
+	}
+
+	TimeBlockCollection TimeBlockPool::acquire()
+	{
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			if (!m_freeBatches.empty())
+			{
+				TimeBlockCollection batch = std::move(m_freeBatches.back());
+				m_freeBatches.pop_back();
+				return batch;
+			}
+		}
+		TimeBlockCollection batch;
+		batch.reserve(m_timeBlocksPerBatch);
+		return batch;
+	}
+
+	void TimeBlockPool::release(TimeBlockCollection&& batch)
+	{
+		// The readers only fill a batch up to its capacity
+		if (batch.capacity() < m_timeBlocksPerBatch)
+		{
+			batch.reserve(m_timeBlocksPerBatch);
+		}
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_freeBatches.push_back(std::move(batch));
+	}
+
+	size_t TimeBlockPool::getTimeBlocksPerBatch() const
+	{
+		return m_timeBlocksPerBatch;
+	}
+}  // namespace yrt::petsird
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace yrt::petsird
+{
+	// Batches of time blocks reused between reads. Released batches keep
+	//  their elements, so that the deserialized blocks (and their nested
+	//  event vectors) can be overwritten in place by the next read instead of
+	//  being freed and reallocated for every batch
+	class TimeBlockPool
+	{
+	public:
+		explicit TimeBlockPool(size_t timeBlocksPerBatch = 4096);
+
+		// A batch whose capacity is the number of time blocks per batch
+		TimeBlockCollection acquire();
+		void release(TimeBlockCollection&& batch);
+
+		size_t getTimeBlocksPerBatch() const;
+
+	private:
+		size_t m_timeBlocksPerBatch;
+		std::mutex m_mutex;
+		std::vector<TimeBlockCollection> m_freeBatches;
+	};
+}  // namespace yrt::petsird
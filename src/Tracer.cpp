@@ -0,0 +1,121 @@
+#include "Tracer.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <stdexcept>
+
+namespace yrt::petsird
+{
+	Tracer& Tracer::instance()
+	{
+		static Tracer tracer;
+		return tracer;
+	}
+
+	Tracer::Tracer()
+	    : m_enabled(false), m_epoch(std::chrono::steady_clock::now())
+	{
+	}
+
+	void Tracer::setEnabled(bool enabled)
+	{
+		m_enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool Tracer::isEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	int64_t Tracer::now_us() const
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+		           std::chrono::steady_clock::now() - m_epoch)
+		    .count();
+	}
+
+	void Tracer::record(const char* name, int64_t start_us, int64_t end_us)
+	{
+		getThreadBuffer().events.push_back(
+		    TraceEvent{name, start_us, end_us - start_us});
+	}
+
+	Tracer::ThreadBuffer& Tracer::getThreadBuffer()
+	{
+		// The tracer is a singleton, so one buffer per thread is enough
+		thread_local ThreadBuffer* tp_buffer = nullptr;
+		if (tp_buffer == nullptr)
+		{
+			std::lock_guard lock{m_buffersMutex};
+			m_buffers.push_back(std::make_unique<ThreadBuffer>());
+			tp_buffer = m_buffers.back().get();
+			tp_buffer->threadIndex = m_buffers.size() - 1;
+		}
+		return *tp_buffer;
+	}
+
+	void Tracer::writeChromeTrace(const std::string& fname) const
+	{
+		std::ofstream file{fname};
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Could not open " + fname);
+		}
+
+		// Written event by event to avoid building the whole document in
+		//  memory
+		std::lock_guard lock{m_buffersMutex};
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool isFirstEvent = true;
+		for (const auto& buffer : m_buffers)
+		{
+			const nlohmann::json threadName{
+			    {"name", "thread_name"},
+			    {"ph", "M"},
+			    {"pid", 1},
+			    {"tid", buffer->threadIndex},
+			    {"args",
+			     {{"name", "thread " + std::to_string(buffer->threadIndex)}}}};
+			file << (isFirstEvent ? "\n" : ",\n") << threadName.dump();
+			isFirstEvent = false;
+
+			for (const auto& event : buffer->events)
+			{
+				const nlohmann::json eventJSON{{"name", event.name},
+				                               {"cat", "yrt-pet-petsird"},
+				                               {"ph", "X"},
+				                               {"ts", event.start_us},
+				                               {"dur", event.duration_us},
+				                               {"pid", 1},
+				                               {"tid", buffer->threadIndex}};
+				file << ",\n" << eventJSON.dump();
+			}
+		}
+		file << "\n]}" << std::endl;
+	}
+
+	TraceSpan::TraceSpan(const char* name) : m_name(name), m_start_us(-1)
+	{
+		const Tracer& tracer = Tracer::instance();
+		if (tracer.isEnabled())
+		{
+			m_start_us = tracer.now_us();
+		}
+	}
+
+	TraceSpan::~TraceSpan()
+	{
+		end();
+	}
+
+	void TraceSpan::end()
+	{
+		if (m_start_us >= 0)
+		{
+			Tracer& tracer = Tracer::instance();
+			tracer.record(m_name, m_start_us, tracer.now_us());
+			m_start_us = -1;
+		}
+	}
+}  // namespace yrt::petsird
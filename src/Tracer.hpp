@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird
+{
+	// Low-overhead recorder of timed spans, written in the Chrome trace
+	//  format (Loadable in Perfetto or chrome://tracing). The tracer is
+	//  disabled by default, in which case a span only costs an atomic load.
+	//  Each thread records into its own buffer, so no lock is taken while
+	//  tracing
+	class Tracer
+	{
+	public:
+		static Tracer& instance();
+
+		void setEnabled(bool enabled);
+		bool isEnabled() const;
+
+		// Microseconds since the creation of the tracer
+		int64_t now_us() const;
+
+		// The name must outlive the tracer (use string literals)
+		void record(const char* name, int64_t start_us, int64_t end_us);
+
+		// Must not be called while other threads are recording
+		void writeChromeTrace(const std::string& fname) const;
+
+	private:
+		struct TraceEvent
+		{
+			const char* name;
+			int64_t start_us;
+			int64_t duration_us;
+		};
+		struct ThreadBuffer
+		{
+			size_t threadIndex;
+			std::vector<TraceEvent> events;
+		};
+
+		Tracer();
+		ThreadBuffer& getThreadBuffer();
+
+		std::atomic<bool> m_enabled;
+		const std::chrono::steady_clock::time_point m_epoch;
+		// Buffers are owned by the tracer so that they outlive their thread
+		std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+		mutable std::mutex m_buffersMutex;
+	};
+
+	// Records a span from its construction to its destruction (or to the
+	//  call to end())
+	class TraceSpan
+	{
+	public:
+		explicit TraceSpan(const char* name);
+		~TraceSpan();
+
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+
+		void end();
+
+	private:
+		const char* m_name;
+		// Negative if the tracer is disabled or the span has ended
+		int64_t m_start_us;
+	};
+}  // namespace yrt::petsird
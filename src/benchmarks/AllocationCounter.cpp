@@ -0,0 +1,77 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replacements of the global allocation functions that count the calls.
+//  The array and nothrow forms use these by default
+
+namespace
+{
+	std::atomic<uint64_t> numAllocations{0};
+
+	void* countedAlloc(std::size_t size, std::size_t alignment)
+	{
+		numAllocations.fetch_add(1, std::memory_order_relaxed);
+		if (size == 0)
+		{
+			size = 1;
+		}
+		void* ptr = nullptr;
+		if (alignment <= alignof(std::max_align_t))
+		{
+			ptr = std::malloc(size);
+		}
+		else
+		{
+			// The size must be a multiple of the alignment
+			ptr = std::aligned_alloc(
+			    alignment, (size + alignment - 1) / alignment * alignment);
+		}
+		if (ptr == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+	return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace yrt::petsird::bench
+{
+	uint64_t getNumAllocations()
+	{
+		return numAllocations.load(std::memory_order_relaxed);
+	}
+}  // namespace yrt::petsird::bench
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace yrt::petsird::bench
+{
+	// Number of calls to the global operator new since the start of the
+	//  program (The operator is replaced by AllocationCounter.cpp, which is
+	//  only linked into the benchmarks)
+	uint64_t getNumAllocations();
+
+	// Allocations made between the construction and a call to get()
+	class AllocationCount
+	{
+	public:
+		AllocationCount() : m_start(getNumAllocations()) {}
+
+		uint64_t get() const { return getNumAllocations() - m_start; }
+
+	private:
+		uint64_t m_start;
+	};
+}  // namespace yrt::petsird::bench
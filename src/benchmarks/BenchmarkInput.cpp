@@ -0,0 +1,93 @@
+#include "Benchmarks.hpp"
+
+#include "petsird/binary/protocols.h"
+
+#include <stdexcept>
+
+namespace yrt::petsird::bench
+{
+	BenchmarkInput::BenchmarkInput(const std::string& input_fname)
+	{
+		if (input_fname.empty())
+		{
+			throw std::invalid_argument(
+			    "This benchmark requires an input PETSIRD file (--input)");
+		}
+		::petsird::binary::PETSIRDReader reader{input_fname};
+		reader.ReadHeader(header);
+		convertScanner();
+
+		TimeBlockCollection batch;
+		batch.reserve(1 << 16);
+		while (reader.ReadTimeBlocks(batch))
+		{
+			timeBlocks.insert(timeBlocks.end(), batch.begin(), batch.end());
+		}
+	}
+
+	BenchmarkInput::BenchmarkInput(
+	    const SyntheticScannerOptions& syntheticOptions, size_t numEvents)
+	{
+		constexpr size_t EventsPerTimeBlock = 10000;
+
+		header.scanner = makeSyntheticScannerInformation(syntheticOptions);
+		convertScanner();
+
+		const size_t numTimeBlocks =
+		    (numEvents + EventsPerTimeBlock - 1) / EventsPerTimeBlock;
+		std::vector<::petsird::EventTimeBlock> eventTimeBlocks(numTimeBlocks);
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (size_t timeBlock_i = 0; timeBlock_i < numTimeBlocks; timeBlock_i++)
+		{
+			const size_t firstEvent = timeBlock_i * EventsPerTimeBlock;
+			fillSyntheticEventTimeBlock(
+			    syntheticOptions, header.scanner, timeBlock_i,
+			    std::min(EventsPerTimeBlock, numEvents - firstEvent),
+			    eventTimeBlocks[timeBlock_i]);
+		}
+
+		timeBlocks.reserve(numTimeBlocks);
+		for (auto& eventTimeBlock : eventTimeBlocks)
+		{
+			timeBlocks.emplace_back(std::move(eventTimeBlock));
+		}
+	}
+
+	size_t BenchmarkInput::getNumEvents() const
+	{
+		size_t numEvents = 0;
+		for (const auto& timeBlock : timeBlocks)
+		{
+			if (const auto* eventTimeBlock =
+			        std::get_if<::petsird::EventTimeBlock>(&timeBlock))
+			{
+				for (const auto& promptEvents_mtype0 :
+				     eventTimeBlock->prompt_events)
+				{
+					for (const auto& promptEvents_mtype01 : promptEvents_mtype0)
+					{
+						numEvents += promptEvents_mtype01.size();
+					}
+				}
+			}
+		}
+		return numEvents;
+	}
+
+	void BenchmarkInput::writeToFile(const std::string& fname) const
+	{
+		::petsird::binary::PETSIRDWriter writer{fname};
+		writer.WriteHeader(header);
+		for (const auto& timeBlock : timeBlocks)
+		{
+			writer.WriteTimeBlocks(timeBlock);
+		}
+		writer.EndTimeBlocks();
+	}
+
+	void BenchmarkInput::convertScanner()
+	{
+		scannerContext = std::make_shared<const ScannerContext>(header.scanner);
+	}
+}  // namespace yrt::petsird::bench
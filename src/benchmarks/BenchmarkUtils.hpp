@@ -0,0 +1,69 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace yrt::petsird::bench
+{
+	class Timer
+	{
+	public:
+		Timer() : m_start(std::chrono::steady_clock::now()) {}
+
+		void restart() { m_start = std::chrono::steady_clock::now(); }
+
+		double elapsedSeconds() const
+		{
+			return std::chrono::duration<double>(
+			           std::chrono::steady_clock::now() - m_start)
+			    .count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	// Collects the results of every benchmark that ran and writes them as a
+	//  single JSON document
+	class BenchmarkReport
+	{
+	public:
+		void add(const std::string& name, nlohmann::json result)
+		{
+			result["name"] = name;
+			std::cerr << "[" << name << "] " << result.dump() << std::endl;
+			m_results.push_back(std::move(result));
+		}
+
+		void setContext(const std::string& key, nlohmann::json value)
+		{
+			m_context[key] = std::move(value);
+		}
+
+		// Writes to the standard output if the filename is "-"
+		void write(const std::string& fname) const
+		{
+			const nlohmann::json report{{"context", m_context},
+			                            {"benchmarks", m_results}};
+			if (fname == "-")
+			{
+				std::cout << report.dump(4) << std::endl;
+				return;
+			}
+			std::ofstream file{fname};
+			if (!file.is_open())
+			{
+				throw std::runtime_error("Could not open " + fname);
+			}
+			file << report.dump(4) << std::endl;
+		}
+
+	private:
+		nlohmann::json m_context = nlohmann::json::object();
+		nlohmann::json m_results = nlohmann::json::array();
+	};
+}  // namespace yrt::petsird::bench
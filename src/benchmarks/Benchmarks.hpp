@@ -0,0 +1,67 @@
+#pragma once
+
+#include "BenchmarkUtils.hpp"
+
+#include "ScannerContext.hpp"
+#include "SyntheticData.hpp"
+#include "utils.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yrt::petsird::bench
+{
+	struct BenchmarkOptions
+	{
+		std::string input_fname;
+		std::string imageParams_fname;
+		int numSubsets;
+		int numIterations;
+		// Number of events of the synthetic acquisition used by the
+		//  benchmarks that do not need an input file
+		size_t numSyntheticEvents;
+		std::vector<int> threadCounts;
+	};
+
+	// PETSIRD acquisition loaded once per benchmark, either from a file or
+	//  generated synthetically
+	class BenchmarkInput
+	{
+	public:
+		explicit BenchmarkInput(const std::string& input_fname);
+		BenchmarkInput(const SyntheticScannerOptions& syntheticOptions,
+		               size_t numEvents);
+
+		size_t getNumEvents() const;
+		// Writes the acquisition as a PETSIRD binary file
+		void writeToFile(const std::string& fname) const;
+
+		::petsird::Header header;
+		std::shared_ptr<const ScannerContext> scannerContext;
+		TimeBlockCollection timeBlocks;
+
+	private:
+		void convertScanner();
+	};
+
+	// Conversion benchmarks (synthetic data)
+	void benchFlatIndex(const BenchmarkOptions& options,
+	                    BenchmarkReport& report);
+	void benchExpandDetectionBinPair(const BenchmarkOptions& options,
+	                                 BenchmarkReport& report);
+	void benchReadTimeBlocks(const BenchmarkOptions& options,
+	                         BenchmarkReport& report);
+	void benchStreamingIngest(const BenchmarkOptions& options,
+	                          BenchmarkReport& report);
+	void benchToScanner(const BenchmarkOptions& options,
+	                    BenchmarkReport& report);
+	void benchNormProjectionValue(const BenchmarkOptions& options,
+	                              BenchmarkReport& report);
+
+	// Reconstruction benchmarks (require an input file and image parameters)
+	void benchReconLORLocality(const BenchmarkOptions& options,
+	                           BenchmarkReport& report);
+	void benchReconNUMAPlacement(const BenchmarkOptions& options,
+	                             BenchmarkReport& report);
+}  // namespace yrt::petsird::bench
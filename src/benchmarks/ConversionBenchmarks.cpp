@@ -0,0 +1,266 @@
+#include "AllocationCounter.hpp"
+#include "Benchmarks.hpp"
+
+#include "PETSIRDFile.hpp"
+#include "PETSIRDListMode.hpp"
+#include "PETSIRDNorm.hpp"
+#include "TimeBlockPool.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#include <unistd.h>
+
+namespace yrt::petsird::bench
+{
+	namespace
+	{
+		// Geometry shared by the conversion benchmarks
+		SyntheticScannerOptions getDefaultSyntheticOptions()
+		{
+			SyntheticScannerOptions syntheticOptions;
+			syntheticOptions.numModuleTypes = 2;
+			return syntheticOptions;
+		}
+
+		double getAllocationsPerMillionEvents(uint64_t numAllocations,
+		                                      size_t numEvents)
+		{
+			return numEvents > 0 ? 1e6 * static_cast<double>(numAllocations) /
+			                           static_cast<double>(numEvents) :
+			                       0.0;
+		}
+	}  // namespace
+
+	// Lookups per second in the (type, module, element) to detector map
+	void benchFlatIndex(const BenchmarkOptions& options,
+	                    BenchmarkReport& report)
+	{
+		const SyntheticScannerOptions syntheticOptions =
+		    getDefaultSyntheticOptions();
+		const BenchmarkInput input{syntheticOptions, 0};
+		const auto& scannerInfo = input.header.scanner;
+		const DetectorCorrespondenceMap& correspondenceMap =
+		    input.scannerContext->getCorrespondenceMap();
+		const auto& replicatedModules =
+		    scannerInfo.scanner_geometry.replicated_modules;
+
+		size_t numLookups = 0;
+		uint64_t checksum = 0;
+		const Timer timer;
+		while (numLookups < options.numSyntheticEvents)
+		{
+			for (uint32_t type = 0; type < replicatedModules.size(); type++)
+			{
+				const uint32_t numModules =
+				    replicatedModules[type].transforms.size();
+				const uint32_t numDets = replicatedModules[type]
+				                             .object.detecting_elements
+				                             .transforms.size();
+				for (uint32_t module = 0; module < numModules; module++)
+				{
+					for (uint32_t det = 0; det < numDets; det++)
+					{
+						checksum +=
+						    correspondenceMap.getFlatIndex(type, module, det);
+					}
+				}
+				numLookups += static_cast<size_t>(numModules) * numDets;
+			}
+		}
+		const double elapsed = timer.elapsedSeconds();
+
+		report.add("flat_index", {{"num_lookups", numLookups},
+		                          {"time_s", elapsed},
+		                          {"lookups_per_s", numLookups / elapsed},
+		                          {"checksum", checksum}});
+	}
+
+	// Detection bin pairs expanded per second
+	void benchExpandDetectionBinPair(const BenchmarkOptions& options,
+	                                 BenchmarkReport& report)
+	{
+		const BenchmarkInput input{getDefaultSyntheticOptions(),
+		                           options.numSyntheticEvents};
+		const auto& scannerInfo = input.header.scanner;
+
+		size_t numPairs = 0;
+		uint64_t checksum = 0;
+		const Timer timer;
+		for (const auto& timeBlock : input.timeBlocks)
+		{
+			const auto& promptEvents =
+			    std::get<::petsird::EventTimeBlock>(timeBlock).prompt_events;
+			for (uint32_t type0 = 0; type0 < promptEvents.size(); type0++)
+			{
+				for (uint32_t type1 = 0; type1 < promptEvents[type0].size();
+				     type1++)
+				{
+					for (const auto& event : promptEvents[type0][type1])
+					{
+						const auto expanded =
+						    ::petsird_helpers::expand_detection_bin_pair(
+						        scannerInfo, {type0, type1},
+						        event.detection_bins);
+						checksum += expanded[0].element_index +
+						            expanded[1].element_index;
+					}
+					numPairs += promptEvents[type0][type1].size();
+				}
+			}
+		}
+		const double elapsed = timer.elapsedSeconds();
+
+		report.add("expand_detection_bin_pair",
+		           {{"num_pairs", numPairs},
+		            {"time_s", elapsed},
+		            {"pairs_per_s", numPairs / elapsed},
+		            {"checksum", checksum}});
+	}
+
+	// Decoding throughput of the time blocks into the list-mode arrays, for
+	//  each requested number of threads
+	void benchReadTimeBlocks(const BenchmarkOptions& options,
+	                         BenchmarkReport& report)
+	{
+		const BenchmarkInput input{getDefaultSyntheticOptions(),
+		                           options.numSyntheticEvents};
+		const size_t numEvents = input.getNumEvents();
+		const int initialNumThreads = globals::getNumThreads();
+
+		nlohmann::json runs = nlohmann::json::array();
+		for (const int numThreads : options.threadCounts)
+		{
+			globals::setNumThreads(numThreads);
+
+			const AllocationCount allocations;
+			const Timer timer;
+			const PETSIRDListMode lm{input.scannerContext, input.timeBlocks,
+			                         true};
+			const double elapsed = timer.elapsedSeconds();
+
+			runs.push_back({{"num_threads", globals::getNumThreads()},
+			                {"time_s", elapsed},
+			                {"events_per_s", lm.count() / elapsed},
+			                {"allocations_per_million_events",
+			                 getAllocationsPerMillionEvents(allocations.get(),
+			                                                lm.count())}});
+		}
+		globals::setNumThreads(initialNumThreads);
+
+		report.add("read_time_blocks",
+		           {{"num_events", numEvents}, {"runs", runs}});
+	}
+
+	// Reading and decoding of a PETSIRD file, either by reading all the time
+	//  blocks before decoding them or batch by batch with reused batches.
+	//  The pooled ingest runs twice with the same pool: The second run shows
+	//  the steady state of a long-running process
+	void benchStreamingIngest(const BenchmarkOptions& options,
+	                          BenchmarkReport& report)
+	{
+		const BenchmarkInput input{getDefaultSyntheticOptions(),
+		                           options.numSyntheticEvents};
+		const std::string fname =
+		    (std::filesystem::temp_directory_path() /
+		     ("petsird_benchmarks_ingest_" +
+		      std::to_string(static_cast<long>(getpid())) + ".bin"))
+		        .string();
+		input.writeToFile(fname);
+
+		nlohmann::json runs = nlohmann::json::array();
+		const auto addRun = [&runs](const std::string& method,
+		                            const PETSIRDListMode& lm, double elapsed,
+		                            uint64_t numAllocations)
+		{
+			runs.push_back({{"method", method},
+			                {"time_s", elapsed},
+			                {"events_per_s", lm.count() / elapsed},
+			                {"allocations_per_million_events",
+			                 getAllocationsPerMillionEvents(numAllocations,
+			                                                lm.count())}});
+		};
+
+		{
+			PETSIRDFile file{fname};
+			const AllocationCount allocations;
+			const Timer timer;
+			PETSIRDListMode lm{input.scannerContext, {}, true};
+			lm.readTimeBlocks(file.readAllTimeBlocks());
+			addRun("read_all", lm, timer.elapsedSeconds(), allocations.get());
+		}
+
+		TimeBlockPool pool;
+		for (const char* method : {"pooled_cold", "pooled_warm"})
+		{
+			PETSIRDFile file{fname};
+			const AllocationCount allocations;
+			const Timer timer;
+			PETSIRDListMode lm{input.scannerContext, {}, true};
+			lm.readTimeBlocks(file, pool);
+			addRun(method, lm, timer.elapsedSeconds(), allocations.get());
+		}
+
+		std::filesystem::remove(fname);
+
+		report.add("streaming_ingest",
+		           {{"num_events", input.getNumEvents()}, {"runs", runs}});
+	}
+
+	// Conversion time of the scanner description as the number of crystals
+	//  grows
+	void benchToScanner(const BenchmarkOptions& /*options*/,
+	                    BenchmarkReport& report)
+	{
+		SyntheticScannerOptions syntheticOptions =
+		    getDefaultSyntheticOptions();
+
+		nlohmann::json runs = nlohmann::json::array();
+		for (const size_t numModuleRings : {2, 4, 8, 16})
+		{
+			syntheticOptions.numModuleRings = numModuleRings;
+			const auto scannerInfo =
+			    makeSyntheticScannerInformation(syntheticOptions);
+
+			const Timer timer;
+			const auto [scanner, correspondenceMap] = toScanner(scannerInfo);
+			const double elapsed = timer.elapsedSeconds();
+
+			runs.push_back({{"num_crystals", scanner.getNumDets()},
+			                {"time_s", elapsed}});
+		}
+
+		report.add("to_scanner", {{"runs", runs}});
+	}
+
+	// Normalisation factors computed per second from the detection bin
+	//  efficiencies
+	void benchNormProjectionValue(const BenchmarkOptions& options,
+	                              BenchmarkReport& report)
+	{
+		SyntheticScannerOptions syntheticOptions =
+		    getDefaultSyntheticOptions();
+		syntheticOptions.withEfficiencies = true;
+		const BenchmarkInput input{syntheticOptions, 0};
+
+		const PETSIRDNorm norm{input.scannerContext};
+		const size_t numBins =
+		    std::min<size_t>(norm.count(), options.numSyntheticEvents);
+
+		double checksum = 0.0;
+		const Timer timer;
+		for (bin_t bin = 0; bin < numBins; bin++)
+		{
+			checksum += norm.getProjectionValue(bin);
+		}
+		const double elapsed = timer.elapsedSeconds();
+
+		report.add("norm_projection_value",
+		           {{"num_bins", numBins},
+		            {"time_s", elapsed},
+		            {"bins_per_s", numBins / elapsed},
+		            {"checksum", checksum}});
+	}
+}  // namespace yrt::petsird::bench
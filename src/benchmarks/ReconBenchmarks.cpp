@@ -0,0 +1,121 @@
+#include "Benchmarks.hpp"
+
+#include "PETSIRDListMode.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+#include "yrt-pet/utils/ReconstructionUtils.hpp"
+
+namespace yrt::petsird::bench
+{
+	namespace
+	{
+		// Average time of an OSEM iteration on the list-mode, with
+		//  sensitivity images computed once
+		class IterationTimer
+		{
+		public:
+			IterationTimer(const Scanner& scanner,
+			               const BenchmarkOptions& options)
+			    : mr_scanner(scanner),
+			      mr_options(options),
+			      m_params(options.imageParams_fname)
+			{
+				auto osem = util::createOSEM(mr_scanner);
+				osem->setListModeEnabled(true);
+				osem->setImageParams(m_params);
+				osem->generateSensitivityImages(m_sensImages, "");
+			}
+
+			double timeIteration(const PETSIRDListMode& lm) const
+			{
+				auto osem = util::createOSEM(mr_scanner);
+				osem->setListModeEnabled(true);
+				osem->setImageParams(m_params);
+				osem->setSensitivityImages(m_sensImages);
+				osem->setDataInput(&lm);
+				osem->num_MLEM_iterations = mr_options.numIterations;
+				osem->num_OSEM_subsets = mr_options.numSubsets;
+
+				const Timer timer;
+				osem->reconstruct("");
+				return timer.elapsedSeconds() / mr_options.numIterations;
+			}
+
+		private:
+			const Scanner& mr_scanner;
+			const BenchmarkOptions& mr_options;
+			ImageParams m_params;
+			std::vector<std::unique_ptr<Image>> m_sensImages;
+		};
+	}  // namespace
+
+	// Time of the OSEM iterations with the events in acquisition order versus
+	//  sorted by LOR locality
+	void benchReconLORLocality(const BenchmarkOptions& options,
+	                           BenchmarkReport& report)
+	{
+		const BenchmarkInput input{options.input_fname};
+		const IterationTimer iterationTimer{input.scannerContext->getScanner(),
+		                                    options};
+
+		PETSIRDListMode lm{input.scannerContext, input.timeBlocks};
+		const double iterationTime_acquisitionOrder =
+		    iterationTimer.timeIteration(lm);
+
+		const Timer sortTimer;
+		lm.sortEventsByLORLocality(options.numSubsets);
+		const double sortTime = sortTimer.elapsedSeconds();
+		const double iterationTime_sorted = iterationTimer.timeIteration(lm);
+
+		report.add("recon_lor_locality",
+		           {{"num_events", lm.count()},
+		            {"num_subsets", options.numSubsets},
+		            {"sort_time_s", sortTime},
+		            {"iteration_time_acquisition_order_s",
+		             iterationTime_acquisitionOrder},
+		            {"iteration_time_sorted_s", iterationTime_sorted},
+		            {"speedup",
+		             iterationTime_acquisitionOrder / iterationTime_sorted}});
+	}
+
+	// Time of the OSEM iterations with the events as decoded versus placed
+	//  by the threads that read them (See placeEventsForReconstruction),
+	//  with and without huge pages
+	void benchReconNUMAPlacement(const BenchmarkOptions& options,
+	                             BenchmarkReport& report)
+	{
+		const BenchmarkInput input{options.input_fname};
+		const IterationTimer iterationTimer{input.scannerContext->getScanner(),
+		                                    options};
+
+		nlohmann::json runs = nlohmann::json::array();
+		for (const bool useHugePages : {false, true})
+		{
+			EventStorageOptions storage;
+			storage.useHugePages = useHugePages;
+			PETSIRDListMode lm{input.scannerContext, input.timeBlocks, false,
+			                   storage};
+			const double iterationTime_decoded =
+			    iterationTimer.timeIteration(lm);
+
+			const Timer placeTimer;
+			lm.placeEventsForReconstruction(options.numSubsets);
+			const double placeTime = placeTimer.elapsedSeconds();
+			const double iterationTime_placed =
+			    iterationTimer.timeIteration(lm);
+
+			runs.push_back(
+			    {{"huge_pages", useHugePages},
+			     {"place_time_s", placeTime},
+			     {"iteration_time_decoded_s", iterationTime_decoded},
+			     {"iteration_time_placed_s", iterationTime_placed},
+			     {"speedup", iterationTime_decoded / iterationTime_placed}});
+		}
+
+		report.add("recon_numa_placement",
+		           {{"num_events", input.getNumEvents()},
+		            {"num_subsets", options.numSubsets},
+		            {"num_threads", globals::getNumThreads()},
+		            {"runs", runs}});
+	}
+}  // namespace yrt::petsird::bench
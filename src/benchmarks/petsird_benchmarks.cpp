@@ -0,0 +1,108 @@
+#include "Benchmarks.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include "CLI11.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace yrt::petsird::bench;
+
+	struct RegisteredBenchmark
+	{
+		void (*run)(const BenchmarkOptions&, BenchmarkReport&);
+		bool requiresInput;
+	};
+
+	const std::map<std::string, RegisteredBenchmark> Benchmarks{
+	    {"flat_index", {benchFlatIndex, false}},
+	    {"expand_detection_bin_pair", {benchExpandDetectionBinPair, false}},
+	    {"read_time_blocks", {benchReadTimeBlocks, false}},
+	    {"streaming_ingest", {benchStreamingIngest, false}},
+	    {"to_scanner", {benchToScanner, false}},
+	    {"norm_projection_value", {benchNormProjectionValue, false}},
+	    {"recon_lor_locality", {benchReconLORLocality, true}},
+	    {"recon_numa_placement", {benchReconNUMAPlacement, true}}};
+}  // namespace
+
+int main(int argc, char** argv)
+{
+	CLI::App app{"Benchmarks of the PETSIRD to YRT-PET conversion"};
+
+	BenchmarkOptions options;
+	int numThreads = -1;
+	std::vector<std::string> selectedBenchmarks;
+	std::string out_fname;
+
+	app.add_option("-i,--input", options.input_fname, "Input PETSIRD file")
+	    ->check(CLI::ExistingFile);
+	app.add_option("-p,--params", options.imageParams_fname,
+	               "Image parameters file (for the reconstruction benchmarks)")
+	    ->check(CLI::ExistingFile);
+	app.add_option("--num_subsets", options.numSubsets, "Number of subsets")
+	    ->default_val(1);
+	app.add_option("--num_iterations", options.numIterations,
+	               "Number of iterations")
+	    ->default_val(1);
+	app.add_option("--num_events", options.numSyntheticEvents,
+	               "Number of synthetic events (or lookups) used by the "
+	               "conversion benchmarks")
+	    ->default_val(10000000);
+	app.add_option("--thread_counts", options.threadCounts,
+	               "Numbers of threads compared by the read_time_blocks "
+	               "benchmark")
+	    ->default_val(std::vector<int>{1, 8, 64});
+	app.add_option("--num_threads", numThreads, "Number of threads to use");
+	app.add_option("-b,--benchmarks", selectedBenchmarks,
+	               "Benchmarks to run (All by default)");
+	app.add_option("-o,--out", out_fname,
+	               "Output JSON file (\"-\" for the standard output)")
+	    ->default_val("-");
+
+	CLI11_PARSE(app, argc, argv);
+
+	yrt::globals::setNumThreads(numThreads);
+
+	if (selectedBenchmarks.empty())
+	{
+		for (const auto& [name, benchmark] : Benchmarks)
+		{
+			selectedBenchmarks.push_back(name);
+		}
+	}
+
+	BenchmarkReport report;
+	report.setContext("version", YRTPET_PETSIRD_VERSION);
+	report.setContext("num_threads", yrt::globals::getNumThreads());
+	report.setContext("input", options.input_fname);
+	report.setContext("num_synthetic_events", options.numSyntheticEvents);
+
+	nlohmann::json skipped = nlohmann::json::array();
+	for (const auto& name : selectedBenchmarks)
+	{
+		const auto it = Benchmarks.find(name);
+		if (it == Benchmarks.end())
+		{
+			std::cerr << "Unknown benchmark: " << name << std::endl;
+			return 1;
+		}
+		if (it->second.requiresInput &&
+		    (options.input_fname.empty() || options.imageParams_fname.empty()))
+		{
+			std::cerr << "[" << name << "] Skipped: requires --input and "
+			          << "--params" << std::endl;
+			skipped.push_back(name);
+			continue;
+		}
+		it->second.run(options, report);
+	}
+	report.setContext("skipped", skipped);
+
+	report.write(out_fname);
+
+	return 0;
+}
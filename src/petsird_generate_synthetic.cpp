@@ -0,0 +1,136 @@
+#include "SyntheticData.hpp"
+
+#include "petsird/binary/protocols.h"
+#include "petsird/protocols.h"
+#include "petsird/types.h"
+
+#include "CLI11.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Generates a PETSIRD file of a synthetic scanner (See SyntheticData.hpp)
+//  with a deterministic stream of prompt events
+
+int main(int argc, char** argv)
+{
+	CLI::App app{"Generates a synthetic PETSIRD scanner and list-mode"};
+
+	yrt::petsird::SyntheticScannerOptions options;
+	uint64_t numEvents;
+	size_t eventsPerTimeBlock;
+	size_t timeBlocksPerBatch;
+	std::string output_fname;
+
+	app.add_option("-o,--out", output_fname, "Output PETSIRD file")
+	    ->required();
+	app.add_option("--num_module_rings", options.numModuleRings,
+	               "Number of axial rings of modules")
+	    ->default_val(4)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--num_modules", options.numModulesPerRing,
+	               "Number of modules in each ring")
+	    ->default_val(32)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--num_crystals_trans", options.numCrystalsTrans,
+	               "Number of crystals per module in the transaxial direction")
+	    ->default_val(8)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--num_crystals_axial", options.numCrystalsAxial,
+	               "Number of crystals per module in the axial direction")
+	    ->default_val(8)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--num_module_types", options.numModuleTypes,
+	               "Number of module types (at most the number of module "
+	               "rings)")
+	    ->default_val(1)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--num_tof_bins", options.numTOFBins, "Number of TOF bins")
+	    ->default_val(21)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--num_energy_bins", options.numEnergyBins,
+	               "Number of energy bins")
+	    ->default_val(1)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--num_events", numEvents,
+	               "Total number of prompt events")
+	    ->default_val(1000000);
+	app.add_option("--events_per_block", eventsPerTimeBlock,
+	               "Number of events in each time block")
+	    ->default_val(10000)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--blocks_per_batch", timeBlocksPerBatch,
+	               "Number of time blocks generated in parallel")
+	    ->default_val(64)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--seed", options.seed, "Seed of the event stream")
+	    ->default_val(0);
+	app.add_option("--radius", options.radius,
+	               "Inner radius of the scanner (in mm)")
+	    ->default_val(400.0f);
+	app.add_option("--crystal_size_trans", options.crystalSize_trans,
+	               "Transaxial size of the crystals (in mm)")
+	    ->default_val(4.0f);
+	app.add_option("--crystal_size_z", options.crystalSize_z,
+	               "Axial size of the crystals (in mm)")
+	    ->default_val(4.0f);
+	app.add_option("--crystal_depth", options.crystalDepth,
+	               "Depth of the crystals (in mm)")
+	    ->default_val(20.0f);
+	app.add_flag("--efficiencies", options.withEfficiencies,
+	             "Generate detection bin efficiencies");
+
+	CLI11_PARSE(app, argc, argv);
+
+	if (options.numModuleTypes > options.numModuleRings)
+	{
+		std::cerr << "There cannot be more module types than module rings"
+		          << std::endl;
+		return 1;
+	}
+
+	petsird::Header header;
+	header.scanner = yrt::petsird::makeSyntheticScannerInformation(options);
+
+	petsird::binary::PETSIRDWriter writer{output_fname};
+	writer.WriteHeader(header);
+
+	const uint64_t numTimeBlocks =
+	    (numEvents + eventsPerTimeBlock - 1) / eventsPerTimeBlock;
+
+	// Blocks are generated in parallel, batch by batch, and written in order
+	std::vector<petsird::EventTimeBlock> batch(timeBlocksPerBatch);
+	for (uint64_t batchStart = 0; batchStart < numTimeBlocks;
+	     batchStart += timeBlocksPerBatch)
+	{
+		const size_t numBlocksInBatch = static_cast<size_t>(std::min<uint64_t>(
+		    timeBlocksPerBatch, numTimeBlocks - batchStart));
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (size_t block_i = 0; block_i < numBlocksInBatch; block_i++)
+		{
+			const uint64_t timeBlock_i = batchStart + block_i;
+			const uint64_t firstEvent = timeBlock_i * eventsPerTimeBlock;
+			const size_t numEventsInBlock = static_cast<size_t>(
+			    std::min<uint64_t>(eventsPerTimeBlock, numEvents - firstEvent));
+			yrt::petsird::fillSyntheticEventTimeBlock(
+			    options, header.scanner, timeBlock_i, numEventsInBlock,
+			    batch[block_i]);
+		}
+
+		for (size_t block_i = 0; block_i < numBlocksInBatch; block_i++)
+		{
+			writer.WriteTimeBlocks(petsird::TimeBlock{batch[block_i]});
+		}
+	}
+
+	writer.EndTimeBlocks();
+
+	std::cout << "Wrote " << numEvents << " events in " << numTimeBlocks
+	          << " time blocks to " << output_fname << std::endl;
+
+	return 0;
+}
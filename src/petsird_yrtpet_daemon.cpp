@@ -0,0 +1,396 @@
+#include "BoundedQueue.hpp"
+#include "Profiler.hpp"
+#include "ProgressReporter.hpp"
+#include "Reconstruction.hpp"
+#include "ReconstructionCaches.hpp"
+#include "SensitivityCache.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include "CLI11.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * Long-lived reconstruction worker listening on a local UNIX socket.
+ *
+ * Protocol (one JSON object per line):
+ * - A client connects and sends one request (within 5 s):
+ *   - {"command": "reconstruct", "input": ..., "params": ..., "out": ...}
+ *      (Same keys as the options of petsird_yrtpet_reconstruct, the command
+ *      key can be omitted)
+ *   - {"command": "status"}
+ *   - {"command": "shutdown"}: Stops accepting jobs, finishes the queued
+ *      jobs and exits
+ * - For a reconstruction, the daemon answers {"status": "queued", ...} (or
+ *    "rejected" if the queue is full), keeps the connection open, and
+ *    answers {"status": "done", ...} or {"status": "error", ...} once the job
+ *    ran
+ *
+ * Jobs run one at a time (Each one uses all the threads). Converted
+ *  scanners, normalisations and sensitivity images are kept in LRU caches
+ *  between the jobs.
+ * */
+
+namespace
+{
+	struct DaemonJob
+	{
+		int clientFd;
+		uint64_t jobId;
+		yrt::petsird::ReconstructionOptions options;
+		std::string profile_fname;
+	};
+
+	std::atomic<bool> g_stopRequested{false};
+
+	// Time given to a client to send its request once connected
+	constexpr std::chrono::milliseconds RequestTimeout{5000};
+
+	void handleStopSignal(int)
+	{
+		g_stopRequested = true;
+	}
+
+	void sendResponse(int fd, const nlohmann::json& response)
+	{
+		const std::string line = response.dump() + "\n";
+		size_t numSent = 0;
+		while (numSent < line.size())
+		{
+			// MSG_NOSIGNAL: A disconnected client must not kill the daemon
+			const ssize_t result = send(fd, line.data() + numSent,
+			                            line.size() - numSent, MSG_NOSIGNAL);
+			if (result < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (result <= 0)
+			{
+				return;  // The client left, nothing else to do
+			}
+			numSent += static_cast<size_t>(result);
+		}
+	}
+
+	// Reads up to the first newline (or the end of the stream). Throws if
+	//  the request does not arrive in time, so that a silent client cannot
+	//  block the accept loop
+	std::string receiveLine(int fd, std::chrono::milliseconds timeout)
+	{
+		constexpr size_t MaxRequestLength = 1 << 20;
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+		std::string line;
+		char buffer[4096];
+		while (line.size() < MaxRequestLength)
+		{
+			const auto remaining =
+			    std::chrono::duration_cast<std::chrono::milliseconds>(
+			        deadline - std::chrono::steady_clock::now());
+			if (remaining.count() <= 0)
+			{
+				throw std::runtime_error("Timed out waiting for the request");
+			}
+			pollfd pollFd{fd, POLLIN, 0};
+			const int numReady =
+			    poll(&pollFd, 1, static_cast<int>(remaining.count()));
+			if (numReady < 0 && errno != EINTR)
+			{
+				throw std::runtime_error("Could not read the request: " +
+				                         std::string{std::strerror(errno)});
+			}
+			if (numReady <= 0)
+			{
+				continue;  // Interrupted, or the deadline is reached
+			}
+
+			const ssize_t result = recv(fd, buffer, sizeof(buffer), 0);
+			if (result < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (result <= 0)
+			{
+				break;
+			}
+			// One request per connection: What follows the newline is
+			//  ignored
+			const char* newline = static_cast<const char*>(
+			    std::memchr(buffer, '\n', static_cast<size_t>(result)));
+			if (newline != nullptr)
+			{
+				line.append(buffer, static_cast<size_t>(newline - buffer));
+				break;
+			}
+			line.append(buffer, static_cast<size_t>(result));
+		}
+		return line;
+	}
+
+	int createListeningSocket(const std::string& socket_fname)
+	{
+		sockaddr_un address{};
+		if (socket_fname.size() >= sizeof(address.sun_path))
+		{
+			throw std::invalid_argument("Socket path too long: " +
+			                            socket_fname);
+		}
+		address.sun_family = AF_UNIX;
+		std::strncpy(address.sun_path, socket_fname.c_str(),
+		             sizeof(address.sun_path) - 1);
+
+		const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+		{
+			throw std::runtime_error("Could not create the socket: " +
+			                         std::string{std::strerror(errno)});
+		}
+		// Remove the socket left by a previous run
+		unlink(socket_fname.c_str());
+		// Only the owner can submit jobs: The socket file is created with
+		//  these permissions (A chmod after the bind would leave a window)
+		const mode_t previousUmask = umask(S_IRWXG | S_IRWXO | S_IXUSR);
+		const int bindResult = bind(
+		    fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+		const int bindErrno = errno;
+		umask(previousUmask);
+		if (bindResult != 0 || listen(fd, SOMAXCONN) != 0)
+		{
+			const std::string error =
+			    std::strerror(bindResult != 0 ? bindErrno : errno);
+			close(fd);
+			throw std::runtime_error("Could not listen on " + socket_fname +
+			                         ": " + error);
+		}
+		return fd;
+	}
+
+	void runJobs(yrt::petsird::BoundedQueue<DaemonJob>& pr_queue,
+	             yrt::petsird::ReconstructionCaches& pr_caches,
+	             yrt::petsird::ProgressReporter& pr_progress)
+	{
+		while (auto job = pr_queue.pop())
+		{
+			std::cout << "Job " << job->jobId << ": "
+			          << job->options.input_fname << std::endl;
+
+			yrt::petsird::Profiler profiler;
+			profiler.setContext("input", job->options.input_fname);
+			profiler.setContext("num_threads",
+			                    std::to_string(yrt::globals::getNumThreads()));
+			const auto start = std::chrono::steady_clock::now();
+			try
+			{
+				const auto acquisition = yrt::petsird::prepareAcquisition(
+				    job->options, &pr_caches, profiler, pr_progress);
+				yrt::petsird::reconstructAcquisition(acquisition, job->options,
+				                                     &pr_caches, profiler,
+				                                     pr_progress);
+				if (!job->profile_fname.empty())
+				{
+					profiler.writeJSON(job->profile_fname);
+				}
+				sendResponse(
+				    job->clientFd,
+				    {{"status", "done"},
+				     {"job_id", job->jobId},
+				     {"output", job->options.outImage_fname},
+				     {"wall_time_s",
+				      std::chrono::duration<double>(
+				          std::chrono::steady_clock::now() - start)
+				          .count()}});
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "Job " << job->jobId << " failed: " << e.what()
+				          << std::endl;
+				sendResponse(job->clientFd, {{"status", "error"},
+				                             {"job_id", job->jobId},
+				                             {"message", e.what()}});
+			}
+			close(job->clientFd);
+		}
+	}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+	CLI::App app{"PETSIRD reconstruction daemon using YRT-PET"};
+
+	std::string socket_fname;
+	size_t queueSize;
+	size_t scannerCacheSize;
+	size_t sensCacheSize;
+	int numThreads = -1;
+	std::string sensCacheDir;
+	bool noSensCache;
+	float progressInterval_s;
+
+	app.add_option("-s,--socket", socket_fname, "UNIX socket to listen on")
+	    ->required();
+	app.add_option("--queue_size", queueSize,
+	               "Maximum number of jobs waiting to run")
+	    ->default_val(16)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--scanner_cache_size", scannerCacheSize,
+	               "Number of converted scanners (and normalisations) kept "
+	               "in memory")
+	    ->default_val(4);
+	app.add_option("--sens_memory_cache_size", sensCacheSize,
+	               "Number of sets of sensitivity images kept in memory")
+	    ->default_val(8);
+	app.add_option("--num_threads", numThreads, "Number of threads to use");
+	app.add_option("--sens_cache_dir", sensCacheDir,
+	               "Directory where generated sensitivity images are cached")
+	    ->default_val(
+	        yrt::petsird::SensitivityCache::getDefaultCacheDirectory());
+	app.add_flag("--no_sens_cache", noSensCache,
+	             "Do not use the on-disk sensitivity image cache");
+	app.add_option("--progress_interval", progressInterval_s,
+	               "Interval between the progress updates (in seconds, 0 to "
+	               "disable)")
+	    ->default_val(10.0f)
+	    ->check(CLI::NonNegativeNumber);
+
+	CLI11_PARSE(app, argc, argv);
+
+	yrt::globals::setNumThreads(numThreads);
+
+	yrt::petsird::ReconstructionOptions jobDefaults;
+	jobDefaults.sensCacheDir = noSensCache ? "" : sensCacheDir;
+
+	// Interrupt accept() on SIGINT and SIGTERM (no SA_RESTART)
+	struct sigaction stopAction{};
+	stopAction.sa_handler = handleStopSignal;
+	sigemptyset(&stopAction.sa_mask);
+	sigaction(SIGINT, &stopAction, nullptr);
+	sigaction(SIGTERM, &stopAction, nullptr);
+
+	const int listenFd = createListeningSocket(socket_fname);
+	std::cout << "Listening on " << socket_fname << std::endl;
+
+	yrt::petsird::ReconstructionCaches caches{scannerCacheSize, sensCacheSize};
+	yrt::petsird::BoundedQueue<DaemonJob> queue{queueSize};
+	yrt::petsird::ProgressReporter progress{
+	    std::cout,
+	    std::chrono::milliseconds{
+	        static_cast<int64_t>(progressInterval_s * 1000.0f)},
+	    yrt::globals::getNumThreads()};
+	std::thread worker{[&] { runJobs(queue, caches, progress); }};
+
+	uint64_t nextJobId = 0;
+	while (!g_stopRequested)
+	{
+		const int clientFd = accept(listenFd, nullptr, nullptr);
+		if (clientFd < 0)
+		{
+			continue;  // Interrupted by a signal, or a failed connection
+		}
+
+		nlohmann::json request;
+		std::string command;
+		try
+		{
+			request = nlohmann::json::parse(
+			    receiveLine(clientFd, RequestTimeout));
+			command = request.value("command", "reconstruct");
+		}
+		catch (const std::exception& e)
+		{
+			sendResponse(clientFd,
+			             {{"status", "error"}, {"message", e.what()}});
+			close(clientFd);
+			continue;
+		}
+
+		if (command == "status")
+		{
+			sendResponse(clientFd, {{"status", "ok"},
+			                        {"queued_jobs", queue.size()},
+			                        {"queue_size", queueSize}});
+			close(clientFd);
+		}
+		else if (command == "shutdown")
+		{
+			sendResponse(clientFd, {{"status", "shutting_down"},
+			                        {"queued_jobs", queue.size()}});
+			close(clientFd);
+			g_stopRequested = true;
+		}
+		else if (command == "reconstruct")
+		{
+			DaemonJob job;
+			job.clientFd = clientFd;
+			job.jobId = nextJobId;
+			try
+			{
+				job.options =
+				    yrt::petsird::parseReconstructionJob(request, jobDefaults);
+				job.profile_fname = request.value("profile_json", "");
+			}
+			catch (const std::exception& e)
+			{
+				sendResponse(clientFd,
+				             {{"status", "error"}, {"message", e.what()}});
+				close(clientFd);
+				continue;
+			}
+
+			// The answer is sent before the worker owns the connection, which
+			//  it may answer and close as soon as the job is pushed. Only
+			//  this thread pushes, so a queue that is not full now still
+			//  has room when the job is pushed
+			const size_t numQueuedJobs = queue.size();
+			if (numQueuedJobs >= queueSize)
+			{
+				sendResponse(clientFd, {{"status", "rejected"},
+				                        {"message", "The job queue is full"}});
+				close(clientFd);
+				continue;
+			}
+			sendResponse(clientFd, {{"status", "queued"},
+			                        {"job_id", nextJobId},
+			                        {"queued_jobs", numQueuedJobs + 1}});
+			if (!queue.tryPush(job))
+			{
+				sendResponse(clientFd,
+				             {{"status", "rejected"},
+				              {"message", "The job queue is closed"}});
+				close(clientFd);
+				continue;
+			}
+			nextJobId++;
+		}
+		else
+		{
+			sendResponse(clientFd,
+			             {{"status", "error"},
+			              {"message", "Unknown command: " + command}});
+			close(clientFd);
+		}
+	}
+
+	std::cout << "Stopping: Finishing the queued jobs" << std::endl;
+	close(listenFd);
+	unlink(socket_fname.c_str());
+	queue.close();
+	worker.join();
+
+	return 0;
+}
@@ -1,10 +1,19 @@
+#include "yrt-pet/datastruct/projection/Histogram3D.hpp"
 #include "yrt-pet/datastruct/projection/ListMode.hpp"
 #include "yrt-pet/datastruct/scanner/Scanner.hpp"
 #include "yrt-pet/utils/ReconstructionUtils.hpp"
 #include "yrt-pet/utils/Utilities.hpp"
 
+#include "BatchReconstruction.hpp"
+#include "ListModeBinning.hpp"
+#include "MultiBedReconstruction.hpp"
 #include "PETSIRDListMode.hpp"
 #include "PETSIRDNorm.hpp"
+#include "Profiler.hpp"
+#include "ProgressReporter.hpp"
+#include "Reconstruction.hpp"
+#include "SensitivityCache.hpp"
+#include "Tracer.hpp"
 #include "utils.hpp"
 
 #include "hdf5.h"
@@ -16,8 +25,9 @@
 #include "petsird_helpers/geometry.h"
 
 #include "CLI11.hpp"
+#include <chrono>
 #include <string>
-
+#include <vector>
 
 int main(int argc, char** argv)
 {
@@ -25,24 +35,48 @@ int main(int argc, char** argv)
 
 	// Variables to hold parsed values
 	bool useTOF;
-	bool useGPU;
+	bool useGPU = false;
 	bool useNorm;
+	bool noSensCache;
+	bool sortLORs;
+	bool cullFOV;
+	bool coalesceEvents;
+	bool chronologicalSubsets;
+	int numGates = 0;
+	uint32_t gateSignalId = 0;
+	std::string gatingMode_str;
+	int frameDuration_ms = 0;
+	std::string dataMode_str;
+	float histogramThreshold;
 	std::string input_fname;
 	int numSubsets = 0;
 	int numIterations = 0;
+	float previewFraction;
 	int numThreads = -1;
 	std::string imageParams_fname;
 	std::string psfKernel_fname;
 	std::string attImage_fname;
 	std::string outScannerLUT_fname;
+	std::string outListMode_fname;
 	std::string outScannerJSON_fname;
 	std::string outSensImage_fname;
 	std::string sensImage_fname;
+	std::string sensCacheDir;
+	std::string scratchDir;
+	bool useHugePages;
+	bool numaFirstTouch;
 	std::string outImage_fname;
+	std::string profile_fname;
+	std::string trace_fname;
+	std::string batch_fname;
+	size_t sensCacheSize;
+	std::vector<std::string> bed_fnames;
+	std::vector<float> bedPositions_z;
+	size_t numParallelBeds;
+	float progressInterval_s;
 
 	// Add options
 	app.add_option("-i,--input", input_fname, "Input PETSIRD file")
-	    ->required()
 	    ->check(CLI::ExistingFile);
 
 	if (yrt::util::compiledWithCuda())
@@ -58,8 +92,13 @@ int main(int argc, char** argv)
 	app.add_option("--num_iterations", numIterations, "Number of iterations")
 	    ->default_val(10);
 
+	app.add_option("--preview_fraction", previewFraction,
+	               "Quick-look reconstruction from this fraction of the "
+	               "events (a repeatable subsample), on a coarser grid")
+	    ->default_val(1.0f)
+	    ->check(CLI::Range(0.0f, 1.0f));
+
 	app.add_option("-p, --params", imageParams_fname, "Image parameters file")
-	    ->required()
 	    ->check(CLI::ExistingFile);
 
 	app.add_option("--psf", psfKernel_fname, "PSF kernel file")
@@ -72,8 +111,59 @@ int main(int argc, char** argv)
 
 	app.add_flag("--tof", useTOF, "Use TOF information");
 
+	app.add_option("--mode", dataMode_str,
+	               "Reconstruction mode. \"auto\" uses histogram-mode when "
+	               "the number of events is large compared to the number of "
+	               "histogram bins, unless a list-mode option (--coalesce, "
+	               "--sort_lors, gating) is given")
+	    ->check(CLI::IsMember({"auto", "listmode", "histogram"}))
+	    ->default_val("auto");
+	app.add_option("--histogram_threshold", histogramThreshold,
+	               "Number of events per histogram bin above which the "
+	               "automatic mode uses histogram-mode")
+	    ->default_val(yrt::petsird::DEFAULT_HISTOGRAM_MODE_THRESHOLD);
+
+	app.add_flag("--coalesce", coalesceEvents,
+	             "Merge the events sharing the same detector pair and TOF bin "
+	             "into weighted events");
+	app.add_option("--coalesce_frame_duration", frameDuration_ms,
+	               "Duration of the time frames in which events are merged "
+	               "(in ms, 0 for the whole acquisition)")
+	    ->check(CLI::NonNegativeNumber);
+
+	app.add_flag("--chronological_subsets", chronologicalSubsets,
+	             "Split the subsets by event index instead of balancing "
+	             "their angular coverage");
+
+	app.add_flag("--cull_fov", cullFOV,
+	             "Drop the events whose LOR does not cross the image's "
+	             "field of view");
+
+	app.add_flag("--sort_lors", sortLORs,
+	             "Reorder the events of each subset by LOR locality to "
+	             "improve the projector's memory access pattern");
+
+	app.add_option("--num_gates", numGates,
+	               "Number of gates (0 to disable the gating). Each gate is "
+	               "reconstructed into its own image, named after --out with "
+	               "a \"_gate<i>\" suffix")
+	    ->check(CLI::NonNegativeNumber);
+	app.add_option("--gate_signal_id", gateSignalId,
+	               "signal_id of the external signal time blocks used for "
+	               "the gating")
+	    ->default_val(0);
+	app.add_option("--gating_mode", gatingMode_str,
+	               "\"phase\" gates by the position between two triggers "
+	               "(the signal's time blocks), \"amplitude\" by the value "
+	               "of the signal")
+	    ->check(CLI::IsMember({"phase", "amplitude"}))
+	    ->default_val("phase");
+
 	app.add_option("--out_scanner_lut", outScannerLUT_fname,
 	               "Output scanner LUT file");
+	app.add_option("--out_listmode", outListMode_fname,
+	               "Output list-mode file in YRT-PET's format (timestamp, "
+	               "detector pair and, with --tof, TOF of each event)");
 	// app.add_option("--out-scanner-json", outScannerJSON_fname,
 	//                "Output scanner JSON file");
 
@@ -81,13 +171,65 @@ int main(int argc, char** argv)
 	               "Pre-existing sensitivity image filename");
 	app.add_option("--out_sens", outSensImage_fname,
 	               "Output sensitivity image file");
+	app.add_option("--sens_cache_dir", sensCacheDir,
+	               "Directory where generated sensitivity images are cached")
+	    ->default_val(
+	        yrt::petsird::SensitivityCache::getDefaultCacheDirectory());
+	app.add_flag("--no_sens_cache", noSensCache,
+	             "Always regenerate the sensitivity images");
+	app.add_option("--scratch_dir", scratchDir,
+	               "Directory where the decoded events are kept (mapped) "
+	               "instead of RAM, for acquisitions larger than the memory");
+	app.add_flag("--huge_pages", useHugePages,
+	             "Ask for transparent huge pages for the events in RAM");
+	app.add_flag("--numa_first_touch", numaFirstTouch,
+	             "Place the events on the NUMA node of the threads that read "
+	             "them during the reconstruction");
 	app.add_option("-o, --out", outImage_fname,
-	               "Output reconstructed image file")
-	    ->required();
+	               "Output reconstructed image file");
+	app.add_option("--batch", batch_fname,
+	               "JSON manifest of jobs to reconstruct in this process. "
+	               "The other options are the defaults of the jobs")
+	    ->check(CLI::ExistingFile);
+	app.add_option("--sens_memory_cache_size", sensCacheSize,
+	               "Number of sets of sensitivity images kept in memory "
+	               "during a batch (--sens_cache_dir keeps the others)")
+	    ->default_val(2);
+	app.add_option("--beds", bed_fnames,
+	               "PETSIRD files of the beds of a step-and-shoot "
+	               "acquisition, reconstructed and stitched into --out")
+	    ->check(CLI::ExistingFile);
+	app.add_option("--bed_positions", bedPositions_z,
+	               "Axial position of each bed (in mm). By default, taken "
+	               "from the bed movement time blocks");
+	app.add_option("--parallel_beds", numParallelBeds,
+	               "Number of beds reconstructed at the same time (The "
+	               "threads are split between them)")
+	    ->default_val(2)
+	    ->check(CLI::PositiveNumber);
+	app.add_option("--profile_json", profile_fname,
+	               "Output JSON file with the wall time, CPU time, peak "
+	               "memory and throughput of each stage");
+	app.add_option("--trace_json", trace_fname,
+	               "Output Chrome trace JSON file with the timeline of the "
+	               "threads (Loadable in Perfetto)");
+	app.add_option("--progress_interval", progressInterval_s,
+	               "Interval between the progress updates during the ingest "
+	               "and the sensitivity generation (in seconds, 0 to disable)")
+	    ->default_val(10.0f)
+	    ->check(CLI::NonNegativeNumber);
 
 	CLI11_PARSE(app, argc, argv);
 
-	std::cout << "Input PETSIRD file: " << input_fname << std::endl;
+	if (batch_fname.empty() &&
+	    (imageParams_fname.empty() || outImage_fname.empty() ||
+	     (input_fname.empty() && bed_fnames.empty())))
+	{
+		std::cerr << "--input (or --beds), --params and --out are required "
+		             "(unless --batch is given)"
+		          << std::endl;
+		return 1;
+	}
 
 	/*
 	 * Assumptions made by this program:
@@ -104,96 +246,100 @@ int main(int argc, char** argv)
 
 	yrt::globals::setNumThreads(numThreads);
 
-	// Read PETSIRD FILE
-	auto reader = petsird::binary::PETSIRDReader(input_fname);
-
-	// Read the header and get the scanner
-	petsird::Header header;
-	reader.ReadHeader(header);
-	const petsird::ScannerInformation& scannerInfo = header.scanner;
-
-	// Prepare detCoord
-	auto [scanner, correspondenceMap] = yrt::petsird::toScanner(scannerInfo);
-
-	if (!outScannerLUT_fname.empty())
+	yrt::petsird::Tracer::instance().setEnabled(!trace_fname.empty());
+
+	yrt::petsird::ReconstructionOptions options;
+	options.input_fname = input_fname;
+	options.imageParams_fname = imageParams_fname;
+	options.outImage_fname = outImage_fname;
+	options.psfKernel_fname = psfKernel_fname;
+	options.attImage_fname = attImage_fname;
+	options.sensImage_fname = sensImage_fname;
+	options.outSensImage_fname = outSensImage_fname;
+	options.outScannerLUT_fname = outScannerLUT_fname;
+	options.outListMode_fname = outListMode_fname;
+	options.sensCacheDir = noSensCache ? "" : sensCacheDir;
+	options.scratchDir = scratchDir;
+	options.useHugePages = useHugePages;
+	options.numaFirstTouch = numaFirstTouch;
+	options.useTOF = useTOF;
+	options.useGPU = useGPU;
+	options.useNorm = useNorm;
+	options.coalesceEvents = coalesceEvents;
+	options.frameDuration_ms = frameDuration_ms;
+	options.chronologicalSubsets = chronologicalSubsets;
+	options.sortLORs = sortLORs;
+	options.cullFOV = cullFOV;
+	options.gating.numGates = numGates;
+	options.gating.signalId = gateSignalId;
+	options.gating.mode = yrt::petsird::parseGatingMode(gatingMode_str);
+	options.dataMode = yrt::petsird::parseDataMode(dataMode_str);
+	options.histogramThreshold = histogramThreshold;
+	options.numSubsets = numSubsets;
+	options.numIterations = numIterations;
+	options.previewFraction = previewFraction;
+
+	const std::chrono::milliseconds progressInterval{
+	    static_cast<int64_t>(progressInterval_s * 1000.0f)};
+
+	if (!batch_fname.empty())
 	{
-		std::cout << "Output scanner LUT file: " << outScannerLUT_fname
-		          << std::endl;
-		auto detSetup = scanner.getDetectorSetup();
-		detSetup->writeToFile(outScannerLUT_fname);
+		const size_t numFailedJobs = yrt::petsird::runBatchReconstruction(
+		    batch_fname, options, progressInterval, sensCacheSize);
+		if (!trace_fname.empty())
+		{
+			yrt::petsird::Tracer::instance().writeChromeTrace(trace_fname);
+			std::cout << "Trace written to " << trace_fname << std::endl;
+		}
+		if (numFailedJobs > 0)
+		{
+			std::cerr << numFailedJobs << " jobs failed" << std::endl;
+			return 1;
+		}
+		std::cout << "Done." << std::endl;
+		return 0;
 	}
 
-	// TODO: Save the scanner's JSON file
-
-	// ListMode l = yrt::petsird::PETSIRDListMode();
-	//  Read the header and get the scanner
-	yrt::petsird::TimeBlockCollection timeBlocks;
-	timeBlocks.reserve(1ull << 31);
-
-	const bool readingTimeBlock = reader.ReadTimeBlocks(timeBlocks);
-	if (!readingTimeBlock)
+	if (!bed_fnames.empty())
 	{
-		throw std::runtime_error("Error while reading time blocks");
+		yrt::petsird::runMultiBedReconstruction(
+		    bed_fnames, bedPositions_z, options, numParallelBeds,
+		    progressInterval, profile_fname);
+		if (!trace_fname.empty())
+		{
+			yrt::petsird::Tracer::instance().writeChromeTrace(trace_fname);
+			std::cout << "Trace written to " << trace_fname << std::endl;
+		}
+		std::cout << "Done." << std::endl;
+		return 0;
 	}
 
-	auto lm = std::make_unique<yrt::petsird::PETSIRDListMode>(
-	    scanner, scannerInfo, correspondenceMap, timeBlocks, useTOF);
-
-	// Initialize reconstruction
-	auto osem = yrt::util::createOSEM(scanner, useGPU);
-	osem->setListModeEnabled(true);
-
-	// Read image parameters
-	yrt::ImageParams params{imageParams_fname};
-	osem->setImageParams(params);
+	std::cout << "Input PETSIRD file: " << input_fname << std::endl;
 
-	if (!psfKernel_fname.empty())
-	{
-		osem->addImagePSF(psfKernel_fname);
-	}
+	yrt::petsird::ProgressReporter progress{
+	    std::cout, progressInterval, yrt::globals::getNumThreads()};
 
-	std::unique_ptr<yrt::petsird::PETSIRDNorm> norm;
-	if (useNorm)
-	{
-		norm = std::make_unique<yrt::petsird::PETSIRDNorm>(scanner, scannerInfo,
-		                                                   correspondenceMap);
-		osem->setSensitivityHistogram(norm.get());
-	}
+	yrt::petsird::Profiler profiler;
+	profiler.setContext("input", input_fname);
+	profiler.setContext("num_threads",
+	                    std::to_string(yrt::globals::getNumThreads()));
 
-	std::unique_ptr<yrt::Image> attImage;
-	if (!attImage_fname.empty())
-	{
-		attImage = std::make_unique<yrt::ImageOwned>(attImage_fname);
-		osem->setAttenuationImage(attImage.get());
-	}
+	const auto acquisition = yrt::petsird::prepareAcquisition(
+	    options, nullptr, profiler, progress);
+	yrt::petsird::reconstructAcquisition(acquisition, options, nullptr,
+	                                     profiler, progress);
 
-	std::vector<std::unique_ptr<yrt::Image>> sensImages;
-	if (!sensImage_fname.empty())
+	if (!profile_fname.empty())
 	{
-		sensImages.push_back(
-		    std::make_unique<yrt::ImageOwned>(sensImage_fname));
+		profiler.writeJSON(profile_fname);
+		std::cout << "Profile written to " << profile_fname << std::endl;
 	}
-	else
+	if (!trace_fname.empty())
 	{
-		osem->generateSensitivityImages(sensImages, outSensImage_fname);
+		yrt::petsird::Tracer::instance().writeChromeTrace(trace_fname);
+		std::cout << "Trace written to " << trace_fname << std::endl;
 	}
 
-	osem->setSensitivityImages(sensImages);
-
-	osem->setDataInput(lm.get());
-
-	osem->num_MLEM_iterations = numIterations;
-	osem->num_OSEM_subsets = numSubsets;
-
-	if (useTOF)
-	{
-		float tofResolution_ps =
-		    scannerInfo.tof_resolution[0][0] * 2.0f / yrt::SPEED_OF_LIGHT_MM_PS;
-		osem->addTOF(tofResolution_ps, 5);
-	}
-
-	osem->reconstruct(outImage_fname);
-
 	std::cout << "Done." << std::endl;
 
 	return 0;
@@ -0,0 +1,170 @@
+#include "PETSIRDFile.hpp"
+#include "PETSIRDListMode.hpp"
+#include "ScannerContext.hpp"
+#include "TimeBlockPool.hpp"
+
+#include "yrt-pet/utils/Globals.hpp"
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace yrt::petsird
+{
+	namespace
+	{
+		// List mode and the scanner context it refers to
+		struct PyListMode
+		{
+			std::shared_ptr<ScannerContext> scannerContext;
+			std::unique_ptr<PETSIRDListMode> listMode;
+		};
+
+		// Read-only NumPy view of an event array. The Python object that owns
+		//  the array is the base of the view, which keeps it alive
+		template <typename T>
+		py::array_t<T> makeArrayView(const EventVector<T>& values,
+		                             const py::object& owner)
+		{
+			py::array_t<T> view{static_cast<py::ssize_t>(values.size()),
+			                    values.data(), owner};
+			view.attr("flags").attr("writeable") = false;
+			return view;
+		}
+
+		std::shared_ptr<ScannerContext>
+		    loadScannerContext(const std::string& fname)
+		{
+			const py::gil_scoped_release release;
+			const PETSIRDFile petsirdFile{fname};
+			return std::make_shared<ScannerContext>(
+			    petsirdFile.getHeader().scanner);
+		}
+
+		std::unique_ptr<PyListMode> loadListMode(const std::string& fname,
+		                                         bool useTOF)
+		{
+			// Reading and decoding do not touch Python objects
+			const py::gil_scoped_release release;
+			PETSIRDFile petsirdFile{fname};
+			auto pyListMode = std::make_unique<PyListMode>();
+			pyListMode->scannerContext = std::make_shared<ScannerContext>(
+			    petsirdFile.getHeader().scanner);
+			pyListMode->listMode =
+			    pyListMode->scannerContext->createListMode({}, useTOF);
+			TimeBlockPool timeBlockPool;
+			pyListMode->listMode->readTimeBlocks(petsirdFile, timeBlockPool);
+			return pyListMode;
+		}
+	}  // namespace
+}  // namespace yrt::petsird
+
+PYBIND11_MODULE(yrtpet_petsird, m)
+{
+	using namespace yrt::petsird;
+
+	m.doc() = "Conversion of PETSIRD files to YRT-PET";
+
+	m.def(
+	    "set_num_threads",
+	    [](int numThreads) { yrt::globals::setNumThreads(numThreads); },
+	    py::arg("num_threads"),
+	    "Number of threads used for the decoding (-1 for all the cores)");
+	m.def("get_num_threads", []() { return yrt::globals::getNumThreads(); });
+
+	py::class_<ScannerContext, std::shared_ptr<ScannerContext>>(
+	    m, "ScannerContext",
+	    "PETSIRD scanner converted to a YRT-PET scanner (See toScanner)")
+	    .def_static("from_file", &loadScannerContext, py::arg("fname"),
+	                "Reads the scanner from the header of a PETSIRD file")
+	    .def_property_readonly("num_dets", [](const ScannerContext& self)
+	                           { return self.getScanner().getNumDets(); })
+	    .def_property_readonly("dets_per_ring", [](const ScannerContext& self)
+	                           { return self.getScanner().detsPerRing; })
+	    .def_property_readonly("num_rings", [](const ScannerContext& self)
+	                           { return self.getScanner().numRings; })
+	    .def_property_readonly("hash", &ScannerContext::getHash)
+	    .def(
+	        "get_flat_index",
+	        [](const ScannerContext& self, uint32_t type, uint32_t module,
+	           uint32_t element)
+	        {
+		        return self.getCorrespondenceMap().getFlatIndex(type, module,
+		                                                        element);
+	        },
+	        py::arg("type"), py::arg("module"), py::arg("element"),
+	        "Index in the YRT-PET LUT of a PETSIRD detecting element")
+	    .def(
+	        "get_detector_positions",
+	        [](const ScannerContext& self)
+	        {
+		        const auto& scanner = self.getScanner();
+		        const size_t numDets = scanner.getNumDets();
+		        py::array_t<float> positions{std::vector<py::ssize_t>{
+		            static_cast<py::ssize_t>(numDets), 3}};
+		        auto positions_r = positions.mutable_unchecked<2>();
+		        for (size_t det = 0; det < numDets; det++)
+		        {
+			        const auto position = scanner.getDetectorPos(det);
+			        positions_r(det, 0) = position.x;
+			        positions_r(det, 1) = position.y;
+			        positions_r(det, 2) = position.z;
+		        }
+		        return positions;
+	        },
+	        "Positions of the detectors in the YRT-PET LUT order, in mm");
+
+	py::class_<PyListMode>(m, "ListMode",
+	                       "Prompt events of a PETSIRD file, decoded into "
+	                       "YRT-PET detector indices")
+	    .def(py::init(&loadListMode), py::arg("fname"),
+	         py::arg("use_tof") = false,
+	         "Reads and decodes all the prompt events of a PETSIRD file. "
+	         "The decoding is parallel and releases the GIL")
+	    .def_property_readonly("scanner_context", [](const PyListMode& self)
+	                           { return self.scannerContext; })
+	    .def("__len__",
+	         [](const PyListMode& self) { return self.listMode->count(); })
+	    .def_property_readonly(
+	        "timestamps",
+	        [](const py::object& self)
+	        {
+		        return makeArrayView(self.cast<const PyListMode&>()
+		                                 .listMode->getTimestampArray(),
+		                             self);
+	        },
+	        "Timestamps of the events in ms (read-only view)")
+	    .def_property_readonly(
+	        "d0",
+	        [](const py::object& self)
+	        {
+		        return makeArrayView(self.cast<const PyListMode&>()
+		                                 .listMode->getDetector1Array(),
+		                             self);
+	        },
+	        "First detector of the events (read-only view)")
+	    .def_property_readonly(
+	        "d1",
+	        [](const py::object& self)
+	        {
+		        return makeArrayView(self.cast<const PyListMode&>()
+		                                 .listMode->getDetector2Array(),
+		                             self);
+	        },
+	        "Second detector of the events (read-only view)")
+	    .def_property_readonly(
+	        "tof",
+	        [](const py::object& self)
+	        {
+		        return makeArrayView(
+		            self.cast<const PyListMode&>().listMode->getTOFArray(),
+		            self);
+	        },
+	        "TOF of the events in ps (read-only view, empty without TOF)");
+}
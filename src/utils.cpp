@@ -4,6 +4,8 @@
 
 #include "utils.hpp"
 #include "DetectorCorrespondenceMap.hpp"
+#include "Hasher.hpp"
+#include "Tracer.hpp"
 #include "petsird_helpers/geometry.h"
 #include "yrt-pet/datastruct/scanner/DetCoord.hpp"
 
@@ -54,6 +56,9 @@ std::tuple<yrt::Scanner, yrt::petsird::DetectorCorrespondenceMap>
 		DetectorCorrespondenceMap::DetectorKey originalKey;
 	};
 
+	const TraceSpan toScannerSpan{"toScanner"};
+	TraceSpan phaseSpan{"toScanner: crystal positions"};
+
 	DetectorCorrespondenceMap correspondenceMap;
 
 	const ::petsird::ScannerGeometry& scannerGeom =
@@ -187,6 +192,9 @@ std::tuple<yrt::Scanner, yrt::petsird::DetectorCorrespondenceMap>
 	}
 
 	float axialFOV = maxZ - minZ;
+	phaseSpan.end();
+
+	TraceSpan ringsSpan{"toScanner: group and sort rings"};
 
 	// Step 1: Sort by Z
 	std::sort(indexedPoints.begin(), indexedPoints.end(),
@@ -248,6 +256,10 @@ std::tuple<yrt::Scanner, yrt::petsird::DetectorCorrespondenceMap>
 		          });
 	}
 
+	ringsSpan.end();
+
+	const TraceSpan lutSpan{"toScanner: fill LUT"};
+
 	// Return DetCoord
 	auto detCoord = std::make_shared<yrt::DetCoordOwned>();
 	detCoord->allocate(totalNumDets);
@@ -422,6 +434,105 @@ std::tuple<float, float, float, yrt::Vector3D>
 	        largestDistanceUnitVector};
 }
 
+uint64_t yrt::petsird::hashScannerInformation(
+    const ::petsird::ScannerInformation& scannerInfo)
+{
+	Hasher hasher;
+
+	const auto hashTransform =
+	    [&hasher](const ::petsird::RigidTransformation& transform)
+	{ hasher.updateArray(transform.matrix.data(), transform.matrix.size()); };
+	const auto hashBinEdges = [&hasher](const ::petsird::BinEdges& binEdges)
+	{ hasher.updateArray(binEdges.edges.data(), binEdges.edges.size()); };
+
+	hasher.updateString(scannerInfo.model_name);
+
+	// Geometry
+	const auto& replicatedModules =
+	    scannerInfo.scanner_geometry.replicated_modules;
+	hasher.updateValue(replicatedModules.size());
+	for (const auto& replicatedModule : replicatedModules)
+	{
+		hasher.updateValue(replicatedModule.transforms.size());
+		for (const auto& moduleTransform : replicatedModule.transforms)
+		{
+			hashTransform(moduleTransform);
+		}
+
+		const auto& detectors = replicatedModule.object.detecting_elements;
+		for (const auto& corner : detectors.object.shape.corners)
+		{
+			hasher.updateArray(corner.c.data(), corner.c.size());
+		}
+		hasher.updateValue(detectors.transforms.size());
+		for (const auto& detectorTransform : detectors.transforms)
+		{
+			hashTransform(detectorTransform);
+		}
+	}
+
+	// TOF and energy binning
+	for (const auto& tofBinEdges_mtype0 : scannerInfo.tof_bin_edges)
+	{
+		for (const auto& tofBinEdges : tofBinEdges_mtype0)
+		{
+			hashBinEdges(tofBinEdges);
+		}
+	}
+	for (const auto& tofResolution_mtype0 : scannerInfo.tof_resolution)
+	{
+		hasher.updateArray(tofResolution_mtype0.data(),
+		                   tofResolution_mtype0.size());
+	}
+	for (const auto& energyBinEdges : scannerInfo.event_energy_bin_edges)
+	{
+		hashBinEdges(energyBinEdges);
+	}
+
+	// Detection efficiencies
+	const auto& efficiencies = scannerInfo.detection_efficiencies;
+	hasher.updateValue(efficiencies.detection_bin_efficiencies.has_value());
+	if (efficiencies.detection_bin_efficiencies.has_value())
+	{
+		for (const auto& binEfficiencies :
+		     *efficiencies.detection_bin_efficiencies)
+		{
+			hasher.updateArray(binEfficiencies.data(), binEfficiencies.size());
+		}
+	}
+	hasher.updateValue(efficiencies.module_pair_sgidlut.has_value());
+	if (efficiencies.module_pair_sgidlut.has_value())
+	{
+		for (const auto& sgidLUTs_mtype0 : *efficiencies.module_pair_sgidlut)
+		{
+			for (const auto& sgidLUT : sgidLUTs_mtype0)
+			{
+				hasher.updateArray(sgidLUT.data(), sgidLUT.size());
+			}
+		}
+	}
+	hasher.updateValue(
+	    efficiencies.module_pair_efficiencies_vectors.has_value());
+	if (efficiencies.module_pair_efficiencies_vectors.has_value())
+	{
+		for (const auto& vectors_mtype0 :
+		     *efficiencies.module_pair_efficiencies_vectors)
+		{
+			for (const auto& vector_mtype01 : vectors_mtype0)
+			{
+				for (const auto& modulePairEfficiencies : vector_mtype01)
+				{
+					hasher.updateValue(modulePairEfficiencies.sgid);
+					hasher.updateArray(modulePairEfficiencies.values.data(),
+					                   modulePairEfficiencies.values.size());
+				}
+			}
+		}
+	}
+
+	return hasher.digest();
+}
+
 std::array<petsird::ExpandedDetectionBin, 2>
     petsird_helpers::expand_detection_bin_pair(
         const ScannerInformation& scanner,
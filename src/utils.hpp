@@ -32,6 +32,12 @@ namespace yrt::petsird
 	// - Orientation unit vector
 	std::tuple<float, float, float, Vector3D>
 	    getCrystalInfo(const ::petsird::BoxShape& box);
+
+	// Content hash of the scanner description: Geometry, TOF and energy
+	//  binning, and detection efficiencies. Two ScannerInformation objects
+	//  with the same hash produce the same Scanner and normalisation
+	uint64_t hashScannerInformation(
+	    const ::petsird::ScannerInformation& scannerInfo);
 }  // namespace yrt::petsird
 
 namespace petsird_helpers